@@ -0,0 +1,51 @@
+/*
+  ==============================================================================
+    BlockTimeline.h
+    Musical time across one audio block, with the tempo allowed to ramp
+  ==============================================================================
+*/
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// The host reports tempo and position once per block. With a fixed tempo, ppq is a straight
+// line through the block; during an accelerando / ritardando it bends. The tempo is taken to
+// change linearly across the block, so ppq is quadratic in the sample offset and positions are
+// solved on that curve - a step lands on its exact sample at any buffer size.
+struct BlockTimeline
+{
+    double startPpq = 0.0;
+    double quartersPerSample = 0.0; // Tempo at the block's first sample
+    double rampPerSample = 0.0;     // Change in quartersPerSample per sample
+
+    void set(double ppq, double qps, double ramp, int numSamples)
+    {
+        startPpq = ppq;
+        quartersPerSample = qps;
+
+        // The ramp is an estimate: keep the tempo positive (within 0.25x - 1.75x) over the block
+        const double limit = 0.75 * qps / std::max(1, numSamples);
+        rampPerSample = std::min(limit, std::max(-limit, ramp));
+    }
+
+    double getQuartersPerSampleAt(double sample) const { return quartersPerSample + rampPerSample * sample; }
+
+    double getPpqAt(double sample) const
+    {
+        return startPpq + sample * (quartersPerSample + 0.5 * rampPerSample * sample);
+    }
+
+    // Inverse of getPpqAt: the (fractional) sample where 'ppq' falls
+    double getSampleAt(double ppq) const
+    {
+        const double d = ppq - startPpq;
+        const double disc = quartersPerSample * quartersPerSample + 2.0 * rampPerSample * d;
+        if (disc < 0.0) // Out of reach of the ramp - only happens far outside the block
+            return d > 0.0 ? std::numeric_limits<double>::max() : d / quartersPerSample;
+
+        // Root of 0.5*r*t^2 + q*t - d = 0 in the form that stays exact when r is 0
+        return 2.0 * d / (quartersPerSample + std::sqrt(disc));
+    }
+};
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+    MidiClockFollower.h
+    External 24-PPQN MIDI clock and transport, smoothed by a phase-locked loop
+  ==============================================================================
+*/
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+// Follows MIDI clock (F8), Start / Continue / Stop and Song Position Pointer, with every
+// message stamped at its exact sample time. Raw clock from hardware jitters by a fair part
+// of a millisecond; a second-order loop (a DLL, as in F. Adriaensen's "Using a DLL to filter
+// time") tracks tick time and period, so position and tempo come out smooth. The loop time
+// constant is about three clocks, so tempo changes are followed within a few clocks, and a
+// tick far off the prediction (tempo jump, dropout) relocks from the measured interval.
+// No allocation; the clock keeps the loop locked while the transport is stopped.
+class MidiClockFollower
+{
+public:
+    static constexpr int CLOCKS_PER_QUARTER = 24;
+
+    void reset(double sampleRate)
+    {
+        // 20 - 400 BPM, starting from a 120 BPM guess until real clocks arrive
+        minPeriod = sampleRate * 60.0 / (400.0 * CLOCKS_PER_QUARTER);
+        maxPeriod = sampleRate * 60.0 / (20.0 * CLOCKS_PER_QUARTER);
+        period = sampleRate * 60.0 / (120.0 * CLOCKS_PER_QUARTER);
+        locked = false;
+        transport = Stopped;
+        ticks = 0;
+        resumeTicks = 0;
+        epoch = 0;
+    }
+
+    // Transport messages take effect on the next clock (the first tick after Start is beat 0)
+    void start()                     { resumeTicks = 0; transport = Waiting; epoch++; }
+    void continuePlayback()          { transport = Waiting; epoch++; }
+    void stop()                      { if (transport == Running) resumeTicks = ticks + 1; transport = Stopped; }
+    void setSongPosition(int sixteenths) { if (transport != Running) resumeTicks = (double)sixteenths * (CLOCKS_PER_QUARTER / 4); }
+
+    void clock(double sampleTime)
+    {
+        if (!locked || std::abs(sampleTime - nextTickTime) > 0.5 * period) {
+            // (Re)lock: measured interval if the last tick is recent enough to mean anything
+            double interval = sampleTime - lastClockTime;
+            if (locked && interval >= minPeriod && interval <= maxPeriod) period = interval;
+            locked = true;
+            tickTime = sampleTime;
+            nextTickTime = sampleTime + period;
+        }
+        else {
+            // Loop update: move the prediction part of the way towards the measured tick
+            const double error = sampleTime - nextTickTime;
+            tickTime = nextTickTime;
+            nextTickTime += LOOP_B * error + period;
+            period = std::clamp(period + LOOP_C * error, minPeriod, maxPeriod);
+        }
+        lastClockTime = sampleTime;
+
+        if (transport == Running) ticks += 1.0;
+        else if (transport == Waiting) { ticks = resumeTicks; transport = Running; }
+    }
+
+    bool isRunning() const { return transport == Running; }
+    int getEpoch() const { return epoch; }  // Changes on every Start / Continue (position may jump)
+
+    // Filtered song position (quarter notes) at a sample time, interpolated between ticks
+    double getPpqAt(double sampleTime) const
+    {
+        const double span = std::max(1.0, nextTickTime - tickTime);
+        return (ticks + (sampleTime - tickTime) / span) / CLOCKS_PER_QUARTER;
+    }
+
+    double getQuartersPerSample() const { return 1.0 / (period * CLOCKS_PER_QUARTER); }
+
+private:
+    // Loop bandwidth: omega = 2 pi * 0.05 per tick; b = sqrt(2) omega, c = omega^2 (critically damped)
+    static constexpr double LOOP_OMEGA = 2.0 * 3.14159265358979323846 * 0.05;
+    static constexpr double LOOP_B = 1.41421356237309504880 * LOOP_OMEGA;
+    static constexpr double LOOP_C = LOOP_OMEGA * LOOP_OMEGA;
+
+    enum Transport { Stopped, Waiting, Running };
+    Transport transport = Stopped;
+
+    double period = 1000.0;       // Samples per clock
+    double minPeriod = 1.0, maxPeriod = 1.0e9;
+    double tickTime = 0.0;        // Filtered time of the latest tick
+    double nextTickTime = 0.0;    // Predicted time of the next one
+    double lastClockTime = 0.0;   // Raw time of the latest tick
+    bool locked = false;
+
+    double ticks = 0.0;           // Song position of the latest tick, in clocks
+    double resumeTicks = 0.0;     // Where Continue picks up (Stop position or SPP)
+    int epoch = 0;
+};
@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+    MidiEventBuffer.h
+    Preallocated, time-ordered block of short MIDI events - no JUCE dependency
+  ==============================================================================
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The events one block sends, kept in sample order in storage sized up front (allocate()
+// off the audio thread), so add() never allocates. Readers walk begin()..end() in place -
+// the block's output is never copied to be handed on. Events arrive almost in order, so
+// the sorted insert is a short backwards scan.
+struct MidiEvent
+{
+    int sampleOffset = 0;
+    std::uint8_t bytes[3] = {};
+    std::uint8_t size = 0;
+};
+
+class MidiEventBuffer
+{
+public:
+    void allocate(int maxEvents)
+    {
+        events.assign((size_t)(maxEvents > 1 ? maxEvents : 1), {});
+        numEvents = 0;
+    }
+
+    void clear() { numEvents = 0; }
+
+    // False if the event doesn't fit (more than 3 bytes, or the buffer is full)
+    bool add(const std::uint8_t* data, int numBytes, int sampleOffset)
+    {
+        if (numBytes <= 0 || numBytes > 3 || numEvents >= (int)events.size()) return false;
+
+        // Insert after every event at or before this time (stable for equal times)
+        int pos = numEvents;
+        while (pos > 0 && events[(size_t)(pos - 1)].sampleOffset > sampleOffset) {
+            events[(size_t)pos] = events[(size_t)(pos - 1)];
+            pos--;
+        }
+
+        auto& e = events[(size_t)pos];
+        e.sampleOffset = sampleOffset;
+        e.size = (std::uint8_t)numBytes;
+        for (int i = 0; i < numBytes; ++i) e.bytes[i] = data[i];
+        numEvents++;
+        return true;
+    }
+
+    int capacity() const { return (int)events.size(); }
+    int size() const { return numEvents; }
+    const MidiEvent* begin() const { return events.data(); }
+    const MidiEvent* end() const { return events.data() + numEvents; }
+
+private:
+    std::vector<MidiEvent> events;
+    int numEvents = 0;
+};
@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+    PatternStore.cpp
+    Process-wide, deduplicated storage for track patterns with copy-on-write
+  ==============================================================================
+*/
+
+#include "PatternStore.h"
+#include <cstring>
+
+PatternStore& PatternStore::getInstance()
+{
+    static PatternStore store; // Shared by every plugin instance loaded in this process
+    return store;
+}
+
+std::uint64_t PatternStore::hashSteps(const SharedPattern::Steps& steps)
+{
+    // FNV-1a over each field (not the raw struct - padding bytes are undefined)
+    std::uint64_t h = 0xCBF29CE484222325ull;
+    auto mix = [&h](std::uint64_t v) {
+        for (int i = 0; i < 8; ++i) {
+            h ^= (v >> (i * 8)) & 0xFF;
+            h *= 0x100000001B3ull;
+        }
+    };
+    auto floatBits = [](float f) { std::uint32_t u; std::memcpy(&u, &f, sizeof(u)); return (std::uint64_t)u; };
+
+    mix(steps.size());
+    for (const auto& s : steps) {
+        mix((std::uint64_t)s.active | ((std::uint64_t)s.isTied << 1) | ((std::uint64_t)(s.ratchetCurve & 0xFF) << 8)
+            | ((std::uint64_t)(s.ratchets & 0xFF) << 16) | ((std::uint64_t)(s.note & 0xFF) << 24) | ((std::uint64_t)(s.velocity & 0xFF) << 32));
+        mix(floatBits(s.gate) | (floatBits(s.prob) << 32));
+        mix(floatBits(s.offset));
+        for (int lane : s.lanes) mix((std::uint64_t)(std::int64_t)lane);
+    }
+    return h;
+}
+
+SharedPattern PatternStore::intern(SharedPattern::Steps steps)
+{
+    const auto hash = hashSteps(steps);
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto range = patterns.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (auto existing = it->second.lock()) {
+            if (*existing == steps) return SharedPattern(std::move(existing));
+        }
+    }
+
+    // New content: keep it read-only from here on - every holder copies before editing
+    auto pattern = std::make_shared<const SharedPattern::Steps>(std::move(steps));
+    patterns.emplace(hash, pattern);
+
+    if (patterns.size() >= sweepThreshold) {
+        removeExpired();
+        sweepThreshold = patterns.size() * 2 + 64;
+    }
+    return SharedPattern(std::move(pattern));
+}
+
+void PatternStore::removeExpired()
+{
+    for (auto it = patterns.begin(); it != patterns.end();) {
+        if (it->second.expired()) it = patterns.erase(it);
+        else ++it;
+    }
+}
@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+    PatternStore.h
+    Process-wide, deduplicated storage for track patterns with copy-on-write
+  ==============================================================================
+*/
+
+#pragma once
+#include "SequencerCore.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// One track's steps. Copies share the same storage until one of them is edited: edit()
+// hands out a private copy first if anyone else can see the steps (another track, another
+// plugin instance, the store). Reading never copies or touches the reference count, so the
+// audio thread can read through a handle the message thread owns.
+class SharedPattern
+{
+public:
+    using Steps = std::vector<SequencerCore::Step>;
+
+    SharedPattern() : SharedPattern(Steps()) {}
+    explicit SharedPattern(Steps steps)
+    {
+        auto p = std::make_shared<Steps>(std::move(steps));
+        owned = p.get();
+        data = std::move(p);
+    }
+    explicit SharedPattern(std::shared_ptr<const Steps> shared) : data(std::move(shared)) {}
+
+    const Steps& get() const { return *data; }
+    std::size_t size() const { return data->size(); }
+    bool empty() const { return data->empty(); }
+    const SequencerCore::Step& operator[] (std::size_t index) const { return (*data)[index]; }
+    Steps::const_iterator begin() const { return data->begin(); }
+    Steps::const_iterator end() const { return data->end(); }
+
+    // Writable steps, unshared first (copy-on-write) - message thread, under the structure lock
+    Steps& edit()
+    {
+        if (owned == nullptr || data.use_count() > 1) {
+            auto p = std::make_shared<Steps>(*data);
+            owned = p.get();
+            data = std::move(p);
+        }
+        return *owned;
+    }
+
+    bool isShared() const { return owned == nullptr || data.use_count() > 1; }
+
+private:
+    std::shared_ptr<const Steps> data;
+    Steps* owned = nullptr; // Set while this handle created the storage and may write it
+};
+
+// Every pattern loaded from a preset goes through intern(): if an identical pattern is
+// already alive anywhere in the process (same content hash, same steps), the new track
+// shares it instead of keeping its own copy. Sixty-four instances of one template hold one
+// copy of each pattern. Entries are weak, so patterns nobody uses any more are freed.
+class PatternStore
+{
+public:
+    static PatternStore& getInstance();
+
+    SharedPattern intern(SharedPattern::Steps steps);
+
+    static std::uint64_t hashSteps(const SharedPattern::Steps& steps);
+
+private:
+    PatternStore() = default;
+    void removeExpired();
+
+    std::mutex mutex; // intern() can come from any thread the host restores state on
+    std::unordered_multimap<std::uint64_t, std::weak_ptr<const SharedPattern::Steps>> patterns;
+    std::size_t sweepThreshold = 64;
+};
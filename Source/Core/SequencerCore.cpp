@@ -0,0 +1,267 @@
+/*
+  ==============================================================================
+    SequencerCore.cpp
+    Pattern model, musical tables and generators - no JUCE dependency
+  ==============================================================================
+*/
+
+#include "SequencerCore.h"
+#include <algorithm>
+#include <cmath>
+
+int SequencerCore::getLaneMaximum(int lane)
+{
+    return lane == LaneBend ? 16383 : 127;
+}
+
+double SequencerCore::getLfoRateQuarters(int rateIndex)
+{
+    static const double quarters[NUM_LFO_RATES] = { 16.0, 8.0, 4.0, 2.0, 1.0, 0.5, 0.25 };
+    return quarters[std::clamp(rateIndex, 0, NUM_LFO_RATES - 1)];
+}
+
+double SequencerCore::getLfoValue(int lfoIndex, int shape, double ppq, double cycleQuarters)
+{
+    // Phase comes straight from the song position, so the LFO is the same wherever playback starts
+    double cycles = ppq / cycleQuarters;
+    double cycleIndex = std::floor(cycles);
+    double phase = cycles - cycleIndex;
+
+    switch (shape) {
+        case LfoTriangle: return phase < 0.5 ? 4.0 * phase - 1.0 : 3.0 - 4.0 * phase;
+        case LfoSaw:      return 2.0 * phase - 1.0;
+        case LfoSquare:   return phase < 0.5 ? 1.0 : -1.0;
+        case LfoSampleHold: {
+            // One random value per cycle, hashed from the cycle number - repeatable, no state
+            auto x = (std::uint64_t)(std::int64_t)cycleIndex * 0x9E3779B97F4A7C15ull + (std::uint64_t)(lfoIndex + 1) * 0xBF58476D1CE4E5B9ull;
+            x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+            x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+            x ^= x >> 31;
+            return (double)(x >> 11) / (double)(1ull << 53) * 2.0 - 1.0;
+        }
+        default:          return std::sin(phase * 6.283185307179586476925286766559);
+    }
+}
+
+double SequencerCore::getRatchetPosition(int curve, int hit, int count)
+{
+    // Where hit 'hit' of 'count' starts, as a fraction of the step
+    double x = (double)hit / (double)std::max(1, count);
+    if (curve == RatchetAccelerate) return 1.0 - (1.0 - x) * (1.0 - x); // Gaps shrink
+    if (curve == RatchetDecelerate) return x * x;                       // Gaps grow
+    return x;                                                           // Even
+}
+
+double SequencerCore::getRateQuarters(int rateIndex)
+{
+    // Quarter notes per step for each "rate" choice
+    static const double quarters[NUM_RATES] = {
+        1.0, 0.5, 0.25, 0.125,              // 1/4, 1/8, 1/16, 1/32
+        2.0 / 3.0, 1.0 / 3.0, 1.0 / 6.0,    // 1/4T, 1/8T, 1/16T
+        1.5, 0.75, 0.375                    // 1/4., 1/8., 1/16.
+    };
+    return quarters[std::clamp(rateIndex, 0, NUM_RATES - 1)];
+}
+
+SequencerCore::Step SequencerCore::makeEmptyStep()
+{
+    Step s;
+    s.active = false;
+    s.isTied = false;
+    s.note = 60;
+    s.velocity = 100;
+    s.gate = 0.5f;
+    s.prob = 1.0f;
+    s.offset = 0.0f;
+    s.ratchets = 1;
+    s.ratchetCurve = RatchetEven;
+    s.lanes.fill(LANE_OFF);
+    return s;
+}
+
+void SequencerCore::ensureTrackLength(std::vector<Step>& track, int length)
+{
+    length = std::min(length, MAX_STEPS);
+    if ((int)track.size() < length)
+        track.resize((size_t)length, makeEmptyStep());
+}
+
+//==============================================================================
+namespace
+{
+    // Scale intervals (semitones from root), in "scale" parameter order
+    struct ScaleIntervals { const int* intervals; int count; };
+
+    ScaleIntervals getScaleIntervals(int scaleType)
+    {
+        static const int chromatic[] = {0,1,2,3,4,5,6,7,8,9,10,11};
+        static const int major[] = {0,2,4,5,7,9,11};
+        static const int minor[] = {0,2,3,5,7,8,10};
+        static const int dorian[] = {0,2,3,5,7,9,10};
+        static const int phrygian[] = {0,1,3,5,7,8,10};
+        static const int mixolydian[] = {0,2,4,5,7,9,10};
+        static const int pentatonic[] = {0,2,4,7,9};
+
+        switch(scaleType) {
+            case 1: return { major, 7 };
+            case 2: return { minor, 7 };
+            case 3: return { dorian, 7 };
+            case 4: return { phrygian, 7 };
+            case 5: return { mixolydian, 7 };
+            case 6: return { pentatonic, 5 };
+            default: return { chromatic, 12 };
+        }
+    }
+}
+
+bool SequencerCore::isNoteInScale(int midiNote, int rootNote, int scaleType)
+{
+    if (scaleType < 0 || scaleType > 6) return true; // Unknown scale: everything fits
+
+    const auto scale = getScaleIntervals(scaleType);
+    int noteClass = midiNote % 12;
+    int offset = (noteClass - rootNote + 12) % 12;
+
+    for (int i = 0; i < scale.count; ++i) {
+        if (scale.intervals[i] == offset) return true;
+    }
+    return false;
+}
+
+int SequencerCore::getRandomNoteInScale(Random& random, int rootNote, int scaleType, int minOctave, int maxOctave)
+{
+    const auto scale = getScaleIntervals(scaleType);
+
+    // Pick random octave in range
+    int octave = minOctave + random.nextInt(maxOctave + 1 - minOctave);
+
+    // Pick random scale degree
+    int interval = scale.intervals[random.nextInt(scale.count)];
+
+    // Calculate MIDI note: octave * 12 + root + interval, clamped to valid MIDI range
+    return std::clamp((octave * 12) + rootNote + interval, 0, 127);
+}
+
+//==============================================================================
+void SequencerCore::randomizeSteps(std::vector<Step>& track, int length, float amount, int rootNote, int scaleType, Random& random)
+{
+    if (amount <= 0.0f) return;
+    ensureTrackLength(track, length);
+
+    for (auto& s : track) {
+        // Randomize: Chaos generator - completely replaces values
+        if (random.nextFloat() < amount) {
+            // Structural changes
+            s.active = random.nextFloat() > 0.3f; // 70% chance to be active
+
+            // Note changes (Total replacement)
+            s.note = getRandomNoteInScale(random, rootNote, scaleType, 3, 5); // C3-C5
+
+            // Timbre changes (Total replacement)
+            s.velocity = random.nextInt(60) + 60; // 60-119 range
+            s.gate = 0.2f + (random.nextFloat() * 0.8f);
+            s.prob = 0.7f + (random.nextFloat() * 0.3f);
+
+            // Clear ties usually in randomization to avoid broken chains
+            s.isTied = false;
+        }
+    }
+}
+
+void SequencerCore::mutateSteps(std::vector<Step>& track, int length, float amount, int rootNote, int scaleType, Random& random)
+{
+    if (amount <= 0.0f) return;
+    ensureTrackLength(track, length);
+
+    for (auto& s : track) {
+        // Mutate: Evolution - Shifts existing values slightly
+        // Apply to ACTIVE steps mostly to preserve structure
+        if (s.active && random.nextFloat() < amount) {
+            int type = random.nextInt(4);
+
+            if (type == 0) {
+                // Pitch Shift (Small Interval): nearest scale note 1 or 2 semitones away
+                int offset = random.nextBool() ? 1 : -1;
+                if (random.nextFloat() > 0.7f) offset *= 2; // Occasional larger jump
+
+                int tries = 0;
+                int candidate = s.note + offset;
+                while (!isNoteInScale(candidate, rootNote, scaleType) && tries < 5) {
+                    candidate += (offset > 0 ? 1 : -1);
+                    tries++;
+                }
+                if (isNoteInScale(candidate, rootNote, scaleType)) {
+                    s.note = std::clamp(candidate, 0, 127);
+                }
+            }
+            else if (type == 1) {
+                // Velocity Nudge (+/- 15)
+                int diff = random.nextInt(30) - 15;
+                s.velocity = std::clamp(s.velocity + diff, 1, 127);
+            }
+            else if (type == 2) {
+                // Gate Nudge (+/- 10%)
+                float diff = (random.nextFloat() * 0.2f) - 0.1f;
+                s.gate = std::clamp(s.gate + diff, 0.1f, 1.0f);
+            }
+            else if (type == 3) {
+                 // Probability Nudge
+                 float diff = (random.nextFloat() * 0.2f) - 0.1f;
+                 s.prob = std::clamp(s.prob + diff, 0.0f, 1.0f);
+            }
+        }
+        else if (!s.active && random.nextFloat() < (amount * 0.1f)) {
+             // Very rare chance to revive a dead step
+             s.active = true;
+             s.velocity = 80;
+        }
+    }
+}
+
+void SequencerCore::clearSteps(std::vector<Step>& track)
+{
+    // Reset every step to the default (silent) state
+    for (auto& s : track) {
+        s = makeEmptyStep();
+    }
+}
+
+void SequencerCore::invertSteps(std::vector<Step>& track, int length)
+{
+    // Flip the active/inactive state of all steps
+    ensureTrackLength(track, length);
+    for (auto& s : track) {
+        s.active = !s.active;
+    }
+}
+
+void SequencerCore::reverseSteps(std::vector<Step>& track, int length)
+{
+    // Reverse the order of steps (only within the playing length)
+    ensureTrackLength(track, length);
+    if (length > 0 && length <= (int)track.size()) {
+        std::reverse(track.begin(), track.begin() + length);
+    }
+}
+
+void SequencerCore::euclideanSteps(std::vector<Step>& track, int hits, int length)
+{
+    // Distribute 'hits' evenly across 'length' steps (Bresenham-like Euclidean rhythm)
+    if (hits <= 0 || length <= 0 || hits > length) return;
+    ensureTrackLength(track, length);
+
+    // Clear pattern first
+    for (auto& s : track) {
+        s.active = false;
+        s.isTied = false;
+    }
+
+    int bucket = 0;
+    for (int i = 0; i < length && i < (int)track.size(); ++i) {
+        bucket += hits;
+        if (bucket >= length) {
+            bucket -= length;
+            track[(size_t)i].active = true;
+        }
+    }
+}
@@ -0,0 +1,105 @@
+/*
+  ==============================================================================
+    SequencerCore.h
+    Pattern model, musical tables and generators - no JUCE dependency
+  ==============================================================================
+*/
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Everything about a pattern that doesn't need a plugin host: the step model, rate / ratchet /
+// LFO / scale tables and the generative edits. Built as the StepSequencerCore static library
+// (plain C++17, no JUCE) so a headless engine can link it directly. The scheduler that plays
+// these patterns is SequencerEngine (SequencerEngine.h).
+namespace SequencerCore
+{
+    // Per-step automation lanes, sent on the track's channel alongside its notes
+    enum AutomationLane { LaneCc = 0, LaneBend, LanePressure };
+    inline constexpr int NUM_LANES = 3;
+    inline constexpr int LANE_OFF = -1;    // Lane value not set on this step - nothing is sent
+    int getLaneMaximum(int lane);   // 127, or 16383 for pitch-bend (8192 = centre)
+
+    // Tempo-synced LFO shapes / targets, sampled once per step at its onset
+    inline constexpr int NUM_LFOS = 2;
+    enum LfoShape { LfoSine = 0, LfoTriangle, LfoSaw, LfoSquare, LfoSampleHold };
+    enum LfoTarget { LfoOff = 0, LfoVelocity, LfoGate, LfoProbability, LfoNote, LfoOctave };
+    inline constexpr int NUM_LFO_RATES = 7;
+    double getLfoRateQuarters(int rateIndex);       // Quarter notes per cycle
+    double getLfoValue(int lfoIndex, int shape, double ppq, double cycleQuarters); // -1..1
+
+    struct Step {
+        bool active = true;
+        bool isTied = false;
+        int note = 60;
+        int velocity = 100;
+        float gate = 0.5f; // 0.1 to ~0.9
+        float prob = 1.0f;
+        float offset = 0.0f; // Micro-timing, fraction of a step (-MAX_STEP_OFFSET..+MAX_STEP_OFFSET)
+        int ratchets = 1;    // Retriggers within the step (1 - MAX_RATCHETS)
+        int ratchetCurve = 0; // RatchetCurve
+        std::array<int, NUM_LANES> lanes { { LANE_OFF, LANE_OFF, LANE_OFF } }; // AutomationLane values
+
+        bool operator== (const Step& other) const
+        {
+            return active == other.active && isTied == other.isTied && note == other.note && velocity == other.velocity
+                && gate == other.gate && prob == other.prob && offset == other.offset && ratchets == other.ratchets
+                && ratchetCurve == other.ratchetCurve && lanes == other.lanes;
+        }
+        bool operator!= (const Step& other) const { return !(*this == other); }
+    };
+
+    inline constexpr int MAX_RATCHETS = 8;
+    enum RatchetCurve { RatchetEven = 0, RatchetAccelerate, RatchetDecelerate };
+    inline constexpr int NUM_RATCHET_CURVES = 3;
+    double getRatchetPosition(int curve, int hit, int count); // Start of a hit, fraction of the step
+
+    inline constexpr float MAX_STEP_OFFSET = 0.5f; // Also the scheduler's lookahead, in steps
+
+    // Pattern length limits
+    inline constexpr int MAX_STEPS = 1024;          // Longest supported pattern
+    inline constexpr int DEFAULT_TRACK_LENGTH = 32; // Steps allocated up front for a new track
+
+    Step makeEmptyStep();
+    void ensureTrackLength(std::vector<Step>& track, int length);
+
+    // Step rates ("rate" choices): 1/4 .. 1/16.
+    inline constexpr int NUM_RATES = 10;
+    double getRateQuarters(int rateIndex);    // Quarter notes per step
+
+    // Scales ("scale" choices): Chromatic, Major, Minor, Dorian, Phrygian, Mixolydian, Pentatonic
+    bool isNoteInScale(int midiNote, int rootNote, int scaleType);
+
+    // Small, fast generator for the pattern edits (xorshift64*) - seed it per instance
+    class Random
+    {
+    public:
+        explicit Random(std::uint64_t seed = 0x2545F4914F6CDD1Dull) : state(seed != 0 ? seed : 1) {}
+
+        std::uint64_t nextUInt64()
+        {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 0x2545F4914F6CDD1Dull;
+        }
+        float nextFloat()           { return (float)(nextUInt64() >> 40) / 16777216.0f; } // [0, 1)
+        int nextInt(int maxExclusive) { return maxExclusive > 0 ? (int)((nextUInt64() >> 33) % (std::uint64_t)maxExclusive) : 0; }
+        bool nextBool()             { return (nextUInt64() >> 63) != 0; }
+
+    private:
+        std::uint64_t state;
+    };
+
+    int getRandomNoteInScale(Random& random, int rootNote, int scaleType, int minOctave, int maxOctave);
+
+    // Generative edits on one track. 'length' is the track's playing length: storage grows to it first.
+    void randomizeSteps(std::vector<Step>& track, int length, float amount, int rootNote, int scaleType, Random& random);
+    void mutateSteps(std::vector<Step>& track, int length, float amount, int rootNote, int scaleType, Random& random);
+    void clearSteps(std::vector<Step>& track);
+    void invertSteps(std::vector<Step>& track, int length);
+    void reverseSteps(std::vector<Step>& track, int length);
+    void euclideanSteps(std::vector<Step>& track, int hits, int length);
+}
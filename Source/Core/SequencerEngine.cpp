@@ -0,0 +1,1443 @@
+/*
+  ==============================================================================
+    SequencerEngine.cpp
+    Track playback and event scheduling - no JUCE dependency
+  ==============================================================================
+*/
+
+#include "SequencerEngine.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <random>
+
+using namespace SequencerCore;
+
+//==============================================================================
+SequencerEngine::SequencerEngine()
+    : audioRandom(((std::uint64_t)std::random_device{}() << 32) | std::random_device{}()),
+      patternRandom(((std::uint64_t)std::random_device{}() << 32) | std::random_device{}())
+{
+    // Initialize with 1 track by default
+    tracks.resize(1);
+    trackRepeat.resize(1, 1);
+    trackRate.resize(1, -1);
+    trackLength.resize(1, 0);
+    trackChannel.resize(1, 1);
+    trackBaseNote.resize(1, 60);
+    trackEnabled.set(0, true);
+
+    tracks[0] = SharedPattern(SharedPattern::Steps((size_t)DEFAULT_TRACK_LENGTH, makeEmptyStep())); // Default to silence
+    steps = &tracks[0]; // Point to first track
+
+    for (auto& sent : laneSent) sent.fill(LANE_OFF);
+}
+
+void SequencerEngine::prepare(double sRate, int maxBlockSize)
+{
+    sampleRate = (sRate > 0.0) ? sRate : 44100.0;
+
+    // Output sized for the worst block we expect - process() never grows it
+    output.allocate(getMaxOutputEvents(maxBlockSize));
+    currentStepIndex = 0;
+    internalPpq = 0.0;
+    expectedBlockStartPpq = 0.0;
+    lastBlockNumSamples = 0;
+}
+
+int SequencerEngine::getMaxOutputEvents(int samplesPerBlock) const
+{
+    // Every enabled track stepping at 1/32 at 240 BPM, each step with full ratchets (on + off per
+    // hit) and all lanes smoothed at the finest resolution. Beyond that, events go to the
+    // overflow handler rather than being dropped.
+    const double fastestStepSamples = sampleRate * 60.0 / 240.0 * getRateQuarters(3);
+    const int stepsPerBlock = (int)std::ceil(std::max(1, samplesPerBlock) / fastestStepSamples) + 1;
+    const int eventsPerStep = 2 * MAX_RATCHETS + NUM_LANES * 32;
+    const int tracksInUse = std::max(getNumEnabledTracks(), 4);
+
+    const int releaseAll = 16 * MAX_VOICES_PER_CHANNEL + 2 * 16; // Note-offs + bend / pressure resets
+    const int passThrough = 256;
+    return std::clamp(tracksInUse * stepsPerBlock * eventsPerStep + releaseAll + passThrough, 1024, MAX_OUTPUT_EVENTS);
+}
+
+void SequencerEngine::setOverflowHandler(OverflowHandler handler, void* context)
+{
+    overflowHandler = handler;
+    overflowContext = context;
+}
+
+void SequencerEngine::setSettings(const Settings& newSettings)
+{
+    settings = newSettings;
+}
+
+void SequencerEngine::send(int sampleOffset, std::uint8_t status, int data1, int data2)
+{
+    const std::uint8_t data[3] = { status, (std::uint8_t)(data1 & 0x7f), (std::uint8_t)(data2 & 0x7f) };
+    const int numBytes = data2 < 0 ? 2 : 3;
+    if (!output.add(data, numBytes, sampleOffset) && overflowHandler != nullptr)
+        overflowHandler(overflowContext, data, numBytes, sampleOffset);
+}
+
+void SequencerEngine::send(const MidiEvent& event)
+{
+    if (!output.add(event.bytes, event.size, event.sampleOffset) && overflowHandler != nullptr)
+        overflowHandler(overflowContext, event.bytes, event.size, event.sampleOffset);
+}
+
+//==============================================================================
+SequencerEngine::EventSpan SequencerEngine::process(int numSamples, const Transport& transport, const MidiEvent* input, int numInput)
+{
+    output.clear();
+    blockInfo = {};
+    const auto blockOutput = [this] { return EventSpan { output.begin(), output.end() }; };
+
+    // Never wait for the message thread: without the lock, nothing below reads tracks. Step
+    // decisions (and rebuilds) wait for a block that gets it; decided notes play on meanwhile.
+    std::unique_lock<SpinLock> structureGuard (structureLock, std::try_to_lock);
+    const bool structureLocked = structureGuard.owns_lock();
+    if (structureLocked) releaseHeldSteps();
+
+    // MIDI input is handled in time order with our own events below (notes transpose / record,
+    // other messages are passed through as we go)
+    recordTimingValid = false;
+    int inputIndex = 0;
+    auto consumeInputUpTo = [&](int sampleOffset) {
+        while (inputIndex < numInput && input[inputIndex].sampleOffset <= sampleOffset)
+            handleInputMidi(input[inputIndex++]);
+    };
+
+    // Notes still held from before releaseNotesOnNextBlock()
+    if (releaseNotesPending.exchange(false)) releaseAllNotes(0);
+
+    // Bar reference for song mode: bar 'barRef' starts at 'barRefPpq'
+    songBarRef = transport.hasBar ? transport.barCount : 0;
+    songBarRefPpq = transport.hasBar ? transport.barStartPpq : 0.0;
+
+    if (transport.hasTimeSignature) {
+        timeSignatureNumerator = transport.numerator;
+        timeSignatureDenominator = transport.denominator;
+    }
+
+    const int playMode = settings.playMode;
+    const int clockStopOffset = transport.stopOffset; // Stop inside this block: play up to it, then stop there
+
+    // Check state change
+    if (!transport.isPlaying) {
+        consumeInputUpTo(std::numeric_limits<int>::max()); // Keep latch / held state current while stopped
+
+        // Release everything still sounding if we just stopped (mid-edit, the chain rewinds on the next block)
+        if (isPlaying) {
+            stopTransport(0, playMode == PlayModeChain && structureLocked);
+            pendingChainRewind = playMode == PlayModeChain && !structureLocked;
+        }
+        else if (pendingChainRewind && structureLocked) {
+            setCurrentTrack(0);
+            pendingChainRewind = false;
+        }
+        return blockOutput();
+    }
+
+    currentBPM = transport.bpm > 0 ? transport.bpm : 120.0;
+
+    // Calculate Timing (musical time in quarter notes)
+    double quartersPerSample = currentBPM / (60.0 * sampleRate);
+    double blockStartPpq = transport.hasPosition ? transport.ppq : internalPpq;
+
+    // Relocation tolerance: 2 samples, widened for the drift of a tempo ramp starting or ending
+    double relocationSamples = std::max(2.0, numSamples / 64.0);
+    bool relocated = std::abs(blockStartPpq - expectedBlockStartPpq) > quartersPerSample * relocationSamples + 1.0e-9;
+
+    // The tempo can ramp within the block: positions are solved on the integrated tempo curve
+    double ramp = transport.hasPosition && transport.estimateRamp
+                    ? estimateTempoRamp(blockStartPpq, quartersPerSample, isPlaying && !relocated) : 0.0;
+    blockTimeline.set(blockStartPpq, quartersPerSample, ramp, numSamples);
+    lastBlockStartPpq = blockStartPpq;
+    lastBlockQuartersPerSample = quartersPerSample;
+    lastBlockNumSamples = numSamples;
+    internalPpq = blockTimeline.getPpqAt(numSamples);
+
+    // Recording needs the musical time of each input event
+    recordTimingValid = true;
+
+    // Rebuild the schedule on start, host relocation (loop, seek), play mode changes, global
+    // rate / length changes and track edits (enable / rate / length / add / remove). Otherwise it just runs on.
+    // Settings arrive as one value per block, so a change takes effect from this block's
+    // first sample: steps the lookahead decided early with the old values are decided again.
+    int currentGlobalRate = globalRate.load();
+    int currentGlobalNumSteps = globalNumSteps.load();
+    bool settingsChanged = scheduleDirty.exchange(false) || playMode != scheduledPlayMode
+                        || currentGlobalRate != scheduledGlobalRate || currentGlobalNumSteps != scheduledNumSteps;
+    bool userSwitchedTrack = playMode == PlayModeChain && isPlaying && currentTrack != scheduledChainTrack;
+    expectedBlockStartPpq = internalPpq;
+
+    bool needsRebuild = !isPlaying || relocated || settingsChanged || userSwitchedTrack || pendingRebuild;
+    bool killNotes = !isPlaying || relocated || pendingRebuildKill;
+    if (needsRebuild && !structureLocked) {
+        // The editor is resizing tracks: rebuild on the next block. Nothing is scheduled before
+        // the start; a relocation cuts what rings now. Otherwise the old schedule runs on below.
+        pendingRebuild = true;
+        pendingRebuildKill = killNotes;
+        if (!isPlaying) {
+            consumeInputUpTo(std::numeric_limits<int>::max());
+            return blockOutput();
+        }
+        if (killNotes) dropScheduledNotes(0);
+        needsRebuild = false;
+    }
+    else {
+        pendingRebuild = false;
+        pendingRebuildKill = false;
+    }
+
+    if (!isPlaying) {
+        barsPlayedOnCurrentTrack = 0;
+        beatsPlayedInCurrentBar = 0;
+        currentArrangementEntry = -1;
+    }
+    if (needsRebuild) {
+        rebuildSchedule(blockStartPpq, killNotes);
+        scheduledPlayMode = playMode;
+        scheduledGlobalRate = currentGlobalRate;
+        scheduledNumSteps = currentGlobalNumSteps;
+    }
+    isPlaying = true;
+
+    // Pop only the events that fall inside this block - cost depends on the events due,
+    // not on how many tracks are running or how their lengths line up
+    const int playEnd = clockStopOffset >= 0 ? clockStopOffset : numSamples;
+    while (heapSize > 0)
+    {
+        ScheduledEvent ev = eventHeap[0];
+        double exactOffset = blockTimeline.getSampleAt(ev.ppq);
+        double offset = std::max(0.0, std::ceil(exactOffset - 1.0e-6));
+        if (offset >= playEnd) break;
+
+        // Incoming notes at or before this event take effect first (same-block response)
+        consumeInputUpTo((int)offset);
+
+        std::pop_heap(eventHeap.begin(), eventHeap.begin() + heapSize, eventIsLater);
+        heapSize--;
+
+        auto& ps = playState[(size_t)ev.track];
+
+        // Entries left behind by a hand-over or rebuild are superseded - the live one is still queued
+        if (ev.serial != ps.queuedSerial) continue;
+
+        // The live entry itself can go stale under the track: its note released by another track
+        // on the same note, by voice stealing or by the input gate. Queue whatever it has next.
+        bool stale = false;
+        if (ev.type == EventType::NoteOff) stale = ps.lastNote == -1 || ev.ppq != ps.noteOffPpq;
+        else if (ev.type == EventType::NoteOn) stale = !ps.hasPendingNote || ev.ppq != ps.pendingOnPpq;
+        else if (ev.type == EventType::Lane) { double lanePpq = 0.0; stale = !getLaneEventPpq(ps, lanePpq) || ev.ppq != lanePpq; }
+        else stale = !ps.active || ev.ppq != getStepEventPpq(ps);
+        if (stale) {
+            pushTrackEvent(ev.track);
+            continue;
+        }
+
+        // No lock: the step is decided next block (still half a step early); the track's
+        // note-offs, lane points and note-ons carry on in the meantime
+        if (ev.type == EventType::Step && !structureLocked) {
+            holdStep(ev.track);
+            continue;
+        }
+
+        // Timing invariants (debug builds): every event lands on the first sample at or after its
+        // exact position. Only steps (and their early-shifted notes) may be caught up late after a
+        // reschedule - a note-off is never more than the relocation tolerance late.
+        assert(exactOffset < 0.0 || (offset - exactOffset > -1.0e-3 && offset - exactOffset < 1.0));
+        assert(ev.type != EventType::NoteOff || exactOffset > -(relocationSamples + 1.0e-3));
+
+        if (ev.type == EventType::Step) blockInfo.stepsCrossed++;
+        else blockInfo.maxOnsetError = std::max(blockInfo.maxOnsetError, (float)std::abs(offset - exactOffset));
+
+        if (ev.type == EventType::NoteOff) {
+            // 1. Note Off
+            stopNote(ps.lastChannel, ps.lastNote, (int)offset);
+            ps.lastNote = -1;
+        }
+        else if (ev.type == EventType::Lane) {
+            // CC / pitch-bend / pressure point, just ahead of a note starting at the same time
+            sendLanePoint(ps, (int)offset);
+        }
+        else if (ev.type == EventType::NoteOn) {
+            // 2. Note On at the step's (micro-timed) position
+            // Kill previous note if still ringing (each track is monophonic)
+            if (ps.lastNote != -1) {
+                stopNote(ps.lastChannel, ps.lastNote, (int)offset);
+                ps.lastNote = -1;
+            }
+
+            // Ratchets: each hit queues the next one as another heap event
+            double hitPpq = ps.pendingOnPpq;
+            if (ps.ratchetHit == 0) ps.decidedNoteStarted = true;
+            ps.ratchetHit++;
+            if (ps.ratchetHit < ps.ratchetCount) {
+                ps.pendingOnPpq = ps.ratchetStartPpq + ps.ratchetStepQuarters * getRatchetPosition(ps.ratchetCurve, ps.ratchetHit, ps.ratchetCount);
+                // Gate is a fraction of the gap to the next hit, never overlapping it
+                ps.noteOffPpq = hitPpq + (ps.pendingOnPpq - hitPpq) * std::min(1.0f, ps.pendingGate);
+            }
+            else {
+                // Last (or only) hit: gate relative to what's left of the step, so long / tied gates still ring on
+                double span = ps.ratchetStepQuarters * (1.0 - getRatchetPosition(ps.ratchetCurve, ps.ratchetCount - 1, ps.ratchetCount));
+                ps.noteOffPpq = hitPpq + span * ps.pendingGate;
+                ps.hasPendingNote = false;
+            }
+
+            // Octave and input transpose are applied as the note starts, so they reach the very next hit
+            ps.lastBaseNote = std::clamp(ps.pendingNote + 12 * settings.octave, 0, 127);
+            if (!isInputGateClosed())
+                startNote(ev.track, ps.pendingChannel, std::clamp(ps.lastBaseNote + getInputTranspose(), 0, 127),
+                          ps.pendingVelocity, ps.noteOffPpq, (int)offset);
+        }
+        else {
+            // 3. Step - decided half a step early so a pushed-early note can still be placed
+            advanceTrack(ev.track);
+        }
+        pushTrackEvent(ev.track);
+    }
+    if (clockStopOffset >= 0) {
+        consumeInputUpTo(clockStopOffset);
+        stopTransport(clockStopOffset, playMode == PlayModeChain && structureLocked);
+    }
+    consumeInputUpTo(numSamples);
+
+    // Replace recording: the cleared range is queued once the message thread has caught up;
+    // until then it keeps growing here rather than taking a queue entry per step
+    if (recordRead.load(std::memory_order_acquire) == recordWrite.load(std::memory_order_relaxed)) flushRecordClear();
+
+    // Playhead for the editor follows whichever track it is showing
+    const auto& shown = playState[(size_t)std::clamp(currentTrack.load(), 0, MAX_TRACKS - 1)];
+    if (shown.active) currentStepIndex = std::max(0, shown.stepIndex);
+    return blockOutput();
+}
+
+double SequencerEngine::estimateTempoRamp(double blockStartPpq, double quartersPerSample, bool contiguous) const
+{
+    // The host reports the tempo only at block starts. The change since the last block is either
+    // a ramp or a jump at the boundary; the ppq the last block actually covered tells them apart
+    // (a ramp covers the average of both tempos, a jump covers the old one).
+    if (!contiguous || lastBlockNumSamples <= 0 || lastBlockQuartersPerSample <= 0.0) return 0.0;
+
+    const double n = (double)lastBlockNumSamples;
+    const double fromTempo = (quartersPerSample - lastBlockQuartersPerSample) / n;
+    const double fromPpq = 2.0 * ((blockStartPpq - lastBlockStartPpq) / n - lastBlockQuartersPerSample) / n;
+
+    // Both must agree on the direction; carry the ramp on at the gentler of the two
+    if (fromTempo * fromPpq <= 0.0) return 0.0;
+    return std::abs(fromTempo) < std::abs(fromPpq) ? fromTempo : fromPpq;
+}
+
+SequencerEngine::EventSpan SequencerEngine::processBypassed()
+{
+    // Bypassed: nothing may keep sounding - release our notes and pick up fresh when re-enabled
+    output.clear();
+    releaseNotesPending = false;
+    if (isPlaying) stopPlayback(0);
+    else releaseAllNotes(0);
+    return { output.begin(), output.end() };
+}
+
+//==============================================================================
+void SequencerEngine::handleInputMidi(const MidiEvent& event)
+{
+    const int status = event.bytes[0] & 0xf0;
+    const bool isNoteOn = event.size == 3 && status == 0x90 && event.bytes[2] > 0;
+    const bool isNoteOff = event.size == 3 && (status == 0x80 || (status == 0x90 && event.bytes[2] == 0));
+    const int sampleOffset = event.sampleOffset;
+
+    if (!isNoteOn && !isNoteOff) {
+        send(event); // Pass through
+        return;
+    }
+
+    // Recording: notes are written to the pattern and passed through so the player hears them
+    if (settings.recordMode != RecordOff) {
+        if (isPlaying && recordTimingValid) recordInputNote(event.bytes[1], event.bytes[2], isNoteOn, sampleOffset);
+        send(event);
+        return;
+    }
+
+    // Input off: notes only get here when the host buffer is taken for MIDI clock - pass them on
+    if (settings.inputMode == InputOff) {
+        send(event);
+        return;
+    }
+
+    int note = event.bytes[1];
+
+    // Held keys, most recent last (last-note priority like a mono synth)
+    for (int i = 0; i < numHeldInputNotes; ++i) {
+        if (heldInputNotes[(size_t)i] == note) {
+            for (int j = i + 1; j < numHeldInputNotes; ++j) heldInputNotes[(size_t)j - 1] = heldInputNotes[(size_t)j];
+            numHeldInputNotes--;
+            break;
+        }
+    }
+    if (isNoteOn && numHeldInputNotes < (int)heldInputNotes.size()) {
+        heldInputNotes[(size_t)numHeldInputNotes++] = note;
+    }
+
+    int holdMode = settings.inputHold;
+    int newTranspose = inputTranspose;
+
+    if (numHeldInputNotes > 0) {
+        int played = heldInputNotes[(size_t)numHeldInputNotes - 1];
+        if (settings.inputMode == InputKey) {
+            // Follow the key: shift by the played root relative to the pattern's key, nearest way round
+            newTranspose = ((played % 12) - settings.key + 18) % 12 - 6;
+        }
+        else {
+            newTranspose = played - 60; // C4 plays the pattern as written
+        }
+    }
+    else if (holdMode == InputHold) {
+        newTranspose = 0; // Back to the pattern as written
+    }
+    else if (holdMode == InputGate) {
+        // Pattern only sounds while a key is down. The tracks keep stepping silently (a track
+        // whose note-off was its next event re-queues when that entry pops), so the next key
+        // picks the pattern up at its next note-on.
+        releaseAllNotes(sampleOffset);
+        return;
+    }
+    // InputLatch: keep the last transpose
+
+    if (newTranspose == inputTranspose) return;
+    inputTranspose = newTranspose;
+
+    // Current Note mode retunes what is sounding right now; Next Step waits for the next note-on
+    if (settings.inputApply == InputApplyImmediate) {
+        for (int t = 0; t < MAX_TRACKS; ++t) {
+            auto& ps = playState[(size_t)t];
+            if (ps.lastNote == -1) continue;
+
+            int slot = soundingNotes.find(ps.lastChannel, ps.lastNote);
+            if (slot < 0) continue;
+            int velocity = soundingNotes.get(ps.lastChannel, slot).velocity;
+            int channel = ps.lastChannel;
+
+            stopNote(channel, ps.lastNote, sampleOffset);
+            startNote(t, channel, std::clamp(ps.lastBaseNote + inputTranspose, 0, 127), velocity, ps.noteOffPpq, sampleOffset);
+        }
+    }
+}
+
+void SequencerEngine::recordInputNote(int note, int velocity, bool isNoteOn, int sampleOffset)
+{
+    double ppq = blockTimeline.getPpqAt(sampleOffset);
+
+    if (isNoteOn) {
+        // Quantize to the nearest step of the track being shown
+        // Only playback state is read here - the block may not hold the structure lock
+        int track = currentTrack;
+        if (track < 0 || track >= MAX_TRACKS) return;
+        const auto& ps = playState[(size_t)track];
+        if (!ps.active || ps.stepIndex < 0) return;
+
+        // ps.stepIndex is the step decided at grid step nextStep - 1; count from there
+        int length = ps.length;
+        std::int64_t nearest = (std::int64_t)std::llround(ppq / ps.stepQuarters);
+        std::int64_t index = ps.stepIndex + (nearest - (ps.nextStep - 1));
+        index = ((index % length) + length) % length;
+
+        // Store what will play back as the note heard: undo base note, octave and song transpose
+        int stepNote = std::clamp(note - (ps.baseNote - 60) - settings.octave * 12 - ps.transpose, 0, 127);
+
+        RecordEvent ev;
+        ev.type = RecordEvent::Note;
+        ev.track = track;
+        ev.index = (int)index;
+        ev.note = stepNote;
+        ev.velocity = velocity;
+        pushRecordEvent(ev);
+
+        auto& held = recordingNotes[(size_t)note];
+        held.active = true;
+        held.track = track;
+        held.index = (int)index;
+        held.startPpq = ppq;
+        held.stepQuarters = ps.stepQuarters;
+    }
+    else {
+        // Note-off sets the gate from how long the key was held
+        auto& held = recordingNotes[(size_t)note];
+        if (!held.active) return;
+        held.active = false;
+
+        RecordEvent ev;
+        ev.type = RecordEvent::Gate;
+        ev.track = held.track;
+        ev.index = held.index;
+        ev.gate = (float)std::clamp((ppq - held.startPpq) / held.stepQuarters, 0.05, 16.0);
+        pushRecordEvent(ev);
+    }
+}
+
+void SequencerEngine::pushRecordEvent(const RecordEvent& ev)
+{
+    // Steps cleared so far go first, so a note recorded onto a passed step survives
+    if (ev.type != RecordEvent::Clear) flushRecordClear();
+
+    // Single producer (audio thread), single consumer (applyRecordedEdits) - no locks
+    const int write = recordWrite.load(std::memory_order_relaxed);
+    const int next = (write + 1) % RECORD_FIFO_SIZE;
+    if (next == recordRead.load(std::memory_order_acquire)) {
+        // Full (message thread stalled): dropped rather than blocking audio, and counted for the editor
+        droppedRecordEdits.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    recordBuffer[(size_t)write] = ev;
+    recordWrite.store(next, std::memory_order_release);
+}
+
+void SequencerEngine::clearRecordedStep(int trackIndex, int stepIndex)
+{
+    // Consecutive steps of one track make a single range rather than a queue entry each
+    if (hasPendingClear && pendingClear.track == trackIndex && stepIndex == pendingClear.index + pendingClear.count) {
+        pendingClear.count++;
+        return;
+    }
+    flushRecordClear();
+    pendingClear.type = RecordEvent::Clear;
+    pendingClear.track = trackIndex;
+    pendingClear.index = stepIndex;
+    pendingClear.count = 1;
+    hasPendingClear = true;
+}
+
+void SequencerEngine::flushRecordClear()
+{
+    if (!hasPendingClear) return;
+    hasPendingClear = false;
+    pushRecordEvent(pendingClear);
+}
+
+int SequencerEngine::applyRecordedEdits()
+{
+    // Apply recorded steps on the message thread, where the pattern is normally edited
+    int read = recordRead.load(std::memory_order_relaxed);
+    const int write = recordWrite.load(std::memory_order_acquire);
+    if (read == write) return 0;
+
+    int applied = 0;
+    {
+        const std::lock_guard<SpinLock> lock (structureLock);
+        for (; read != write; read = (read + 1) % RECORD_FIFO_SIZE, ++applied) {
+            const auto& ev = recordBuffer[(size_t)read];
+            if (ev.track < 0 || ev.track >= getNumTracks() || ev.index < 0 || ev.index >= MAX_STEPS) continue;
+            auto& track = tracks[(size_t)ev.track].edit();
+
+            if (ev.type == RecordEvent::Clear) {
+                const int end = std::min(ev.index + ev.count, (int)track.size());
+                for (int i = ev.index; i < end; ++i) track[(size_t)i].active = false;
+                continue;
+            }
+
+            ensureTrackLength(track, ev.index + 1);
+            auto& step = track[(size_t)ev.index];
+            if (ev.type == RecordEvent::Note) {
+                step.active = true;
+                step.isTied = false;
+                step.note = ev.note;
+                step.velocity = ev.velocity;
+            }
+            else {
+                step.gate = ev.gate;
+            }
+        }
+    }
+    recordRead.store(read, std::memory_order_release);
+
+    // The editor picks this up on its next timer tick
+    recordedEditCount++;
+    return applied;
+}
+
+int SequencerEngine::getInputTranspose() const
+{
+    return settings.inputMode != InputOff ? inputTranspose : 0;
+}
+
+bool SequencerEngine::isInputGateClosed() const
+{
+    return settings.inputMode != InputOff
+        && settings.inputHold == InputGate
+        && numHeldInputNotes == 0;
+}
+
+//==============================================================================
+void SequencerEngine::rebuildSchedule(double fromPpq, bool killNotes)
+{
+    heapSize = 0;
+    int numTracks = getNumTracks();
+    int playMode = settings.playMode;
+
+    // Ringing notes are cut on relocation; otherwise they finish their gate
+    if (killNotes) releaseAllNotes(0);
+
+    for (int t = 0; t < MAX_TRACKS; ++t) {
+        auto& ps = playState[(size_t)t];
+        bool wasActive = ps.active;
+        int previousStepIndex = ps.stepIndex;
+        bool hadDecision = ps.hasDecidedStep;
+        double decidedPpq = ps.decidedStepPpq;
+
+        if (killNotes) {
+            ps.hasPendingNote = false;
+            ps.lane.active = false;
+            ps.queuedLane.active = false;
+        }
+
+        bool active = false;
+        if (t < numTracks) {
+            if (playMode == PlayModeLayer) active = trackEnabled.test(t);
+            else active = (t == currentTrack); // Chain / Song: one track at a time, song hands over by bar
+        }
+
+        ps.active = false;
+        if (active) {
+            activateTrack(t, fromPpq);
+            // Chain mode keeps its place in the loop across reschedules; a fresh start begins at step 1
+            if (playMode == PlayModeChain && wasActive && !killNotes) ps.stepIndex = previousStepIndex;
+            if (wasActive && !killNotes && hadDecision) {
+                if (decidedPpq >= fromPpq && !ps.decidedNoteStarted) {
+                    // Decided early but not started: the new grid / length / pattern decides it again
+                    retractDecision(ps, fromPpq);
+                }
+                else {
+                    // Don't decide a step twice: the lookahead may already have handled the next one
+                    ps.nextStep = std::max(ps.nextStep, (std::int64_t)std::floor(decidedPpq / ps.stepQuarters + 1.0e-9) + 1);
+                    ps.hasDecidedStep = true;
+                }
+            }
+        }
+
+        // Inactive tracks (including removed ones) stay queued only for their pending note-off
+        if (ps.active || ps.lastNote != -1 || ps.hasPendingNote || ps.lane.active || ps.queuedLane.active) pushTrackEvent(t);
+    }
+
+    scheduledChainTrack = currentTrack;
+}
+
+void SequencerEngine::stopPlayback(int sampleOffset)
+{
+    releaseAllNotes(sampleOffset);
+    resetLanes(sampleOffset);
+    for (auto& ps : playState) {
+        ps.active = false;
+        ps.hasPendingNote = false;
+        ps.lane.active = false;
+        ps.queuedLane.active = false;
+        ps.stepHeld = false;
+    }
+    heapSize = 0;
+    numHeldSteps = 0;
+    isPlaying = false;
+    assert(soundingNotes.total() == 0); // No note may be left without its note-off
+}
+
+void SequencerEngine::dropScheduledNotes(int sampleOffset)
+{
+    // What a killing rebuild does first, without the structure: cut what rings, forget what is queued
+    releaseAllNotes(sampleOffset);
+    for (auto& ps : playState) {
+        ps.hasPendingNote = false;
+        ps.lane.active = false;
+        ps.queuedLane.active = false;
+    }
+}
+
+void SequencerEngine::stopTransport(int sampleOffset, bool rewindChain)
+{
+    stopPlayback(sampleOffset);
+
+    // RESET TO START: Go back to track 1, step 1
+    // (song mode derives its position from the host bar on restart)
+    currentStepIndex = 0;
+    barsPlayedOnCurrentTrack = 0;
+    beatsPlayedInCurrentBar = 0;
+    if (rewindChain) setCurrentTrack(0); // Back to first track
+}
+
+void SequencerEngine::sendLanePoint(TrackPlayState& ps, int sampleOffset)
+{
+    // A queued segment takes over once it starts, even if the current one had points left
+    double currentPpq = 0.0;
+    bool hasCurrent = ps.lane.active;
+    if (hasCurrent) currentPpq = ps.lane.startPpq + ps.lane.spanQuarters * ps.lane.hit / ps.lane.divisions;
+    if (ps.queuedLane.active && (!hasCurrent || ps.queuedLane.startPpq <= currentPpq)) {
+        ps.lane = ps.queuedLane;
+        ps.queuedLane.active = false;
+    }
+    if (!ps.lane.active) return;
+
+    auto& seg = ps.lane;
+    auto& sent = laneSent[(size_t)(seg.channel - 1)];
+    double t = (double)seg.hit / seg.divisions;
+    const auto channelBits = (std::uint8_t)(seg.channel - 1);
+
+    for (int l = 0; l < NUM_LANES; ++l) {
+        int from = seg.from[(size_t)l];
+        if (from == LANE_OFF) continue;
+        int to = seg.to[(size_t)l];
+        int value = (to == LANE_OFF) ? from : (int)std::lround(from + (to - from) * t);
+        if (value == sent[(size_t)l]) continue; // Thinning: unchanged values aren't resent
+        sent[(size_t)l] = value;
+
+        if (l == LaneCc) send(sampleOffset, (std::uint8_t)(0xb0 | channelBits), settings.laneCc, value);
+        else if (l == LaneBend) send(sampleOffset, (std::uint8_t)(0xe0 | channelBits), value & 0x7f, value >> 7);
+        else send(sampleOffset, (std::uint8_t)(0xd0 | channelBits), value);
+    }
+
+    if (++seg.hit >= seg.divisions) seg.active = false;
+}
+
+void SequencerEngine::resetLanes(int sampleOffset)
+{
+    // Bend and pressure would colour whatever plays next on the channel - return them to rest.
+    // CC values are left where the pattern put them (a CC has no neutral value).
+    for (int channel = 1; channel <= 16; ++channel) {
+        auto& sent = laneSent[(size_t)(channel - 1)];
+        const auto channelBits = (std::uint8_t)(channel - 1);
+        if (sent[LaneBend] != LANE_OFF && sent[LaneBend] != 8192)
+            send(sampleOffset, (std::uint8_t)(0xe0 | channelBits), 0, 64);
+        if (sent[LanePressure] != LANE_OFF && sent[LanePressure] != 0)
+            send(sampleOffset, (std::uint8_t)(0xd0 | channelBits), 0);
+        sent.fill(LANE_OFF);
+    }
+}
+
+//==============================================================================
+void SequencerEngine::startNote(int trackIndex, int channel, int note, int velocity, double endPpq, int sampleOffset)
+{
+    // Same note already held on this channel (another track): end it first so the offs stay paired
+    int slot = soundingNotes.find(channel, note);
+    if (slot >= 0) releaseVoice(channel, slot, sampleOffset);
+
+    // Voice limit: give up the oldest / quietest note on this channel
+    auto mode = settings.voiceSteal == 1 ? NoteTable::StealMode::Quietest : NoteTable::StealMode::Oldest;
+    int victim = soundingNotes.findVictim(channel, settings.voiceLimit, mode);
+    if (victim >= 0) releaseVoice(channel, victim, sampleOffset);
+
+    if (!soundingNotes.add(channel, note, velocity, trackIndex, endPpq)) return;
+
+    auto& ps = playState[(size_t)trackIndex];
+    ps.lastNote = note;
+    ps.lastChannel = channel;
+    send(sampleOffset, (std::uint8_t)(0x90 | (channel - 1)), note, std::clamp(velocity, 1, 127));
+}
+
+void SequencerEngine::stopNote(int channel, int note, int sampleOffset)
+{
+    // Only notes we actually hold get a note-off - never a stray or doubled one
+    int slot = soundingNotes.find(channel, note);
+    if (slot >= 0) releaseVoice(channel, slot, sampleOffset);
+}
+
+void SequencerEngine::releaseVoice(int channel, int slot, int sampleOffset)
+{
+    const auto& voice = soundingNotes.get(channel, slot);
+    send(sampleOffset, (std::uint8_t)(0x80 | (channel - 1)), voice.note, 0);
+
+    // The owning track's own note-off becomes stale
+    if (voice.track >= 0 && voice.track < MAX_TRACKS) {
+        auto& owner = playState[(size_t)voice.track];
+        if (owner.lastNote == voice.note && owner.lastChannel == channel) owner.lastNote = -1;
+    }
+    soundingNotes.remove(channel, slot);
+}
+
+void SequencerEngine::releaseAllNotes(int sampleOffset)
+{
+    // Exact note-offs for what is held - no all-notes-off (CC123) to the synth
+    for (int channel = 1; channel <= 16; ++channel) {
+        while (soundingNotes.count(channel) > 0)
+            releaseVoice(channel, soundingNotes.count(channel) - 1, sampleOffset);
+    }
+    for (auto& ps : playState) ps.lastNote = -1;
+}
+
+//==============================================================================
+void SequencerEngine::activateTrack(int trackIndex, double fromPpq)
+{
+    // Grids are absolute - step n starts at n * stepQuarters - so every track stays bar-aligned
+    auto& ps = playState[(size_t)trackIndex];
+    ps.active = true;
+    ps.stepQuarters = getTrackStepQuarters(trackIndex);
+    ps.nextStep = (std::int64_t)std::ceil(fromPpq / ps.stepQuarters - 1.0e-9);
+    ps.stepIndex = -1; // First step event plays step 1 (chain mode)
+    ps.transpose = 0;
+    ps.hasDecidedStep = false;
+}
+
+void SequencerEngine::retractDecision(TrackPlayState& ps, double fromPpq)
+{
+    // Everything the decision queued starts at or after fromPpq; earlier steps' leftovers start before it
+    if (ps.hasPendingNote && ps.ratchetHit == 0 && ps.pendingOnPpq >= fromPpq) ps.hasPendingNote = false;
+    if (ps.queuedLane.active && ps.queuedLane.startPpq >= fromPpq) ps.queuedLane.active = false;
+    if (ps.lane.active && ps.lane.hit == 0 && ps.lane.startPpq >= fromPpq) ps.lane.active = false;
+    ps.stepIndex = ps.stepIndexBeforeDecision; // Chain mode steps on from its place
+}
+
+void SequencerEngine::handOverTrack(int fromTrack, int toTrack, double atPpq)
+{
+    // Chain / song mode: the outgoing track only stays scheduled for its pending note-on / note-off
+    playState[(size_t)fromTrack].active = false;
+    setCurrentTrack(toTrack);
+    activateTrack(toTrack, atPpq);
+    pushTrackEvent(toTrack);
+    scheduledChainTrack = toTrack;
+}
+
+void SequencerEngine::pushTrackEvent(int trackIndex)
+{
+    // One heap entry per track: whichever comes first of its note-off, its next lane
+    // point, its pending note-on and its next step. It supersedes any entry still queued.
+    auto& ps = playState[(size_t)trackIndex];
+    const std::uint32_t serial = ++ps.queuedSerial;
+
+    ScheduledEvent ev;
+    if (!getNextTrackEvent(trackIndex, ev)) return;
+    ev.serial = serial;
+
+    // Superseded entries left queued can fill the heap; dropping them always makes room
+    if (heapSize >= (int)eventHeap.size()) compactEventHeap();
+    eventHeap[(size_t)heapSize++] = ev;
+    std::push_heap(eventHeap.begin(), eventHeap.begin() + heapSize, eventIsLater);
+}
+
+void SequencerEngine::compactEventHeap()
+{
+    // Only live entries stay - at most one per track, so at most MAX_TRACKS of them
+    auto liveEnd = std::remove_if(eventHeap.begin(), eventHeap.begin() + heapSize, [this](const ScheduledEvent& ev) {
+        return ev.serial != playState[(size_t)ev.track].queuedSerial;
+    });
+    heapSize = (int)(liveEnd - eventHeap.begin());
+    std::make_heap(eventHeap.begin(), liveEnd, eventIsLater);
+}
+
+bool SequencerEngine::getNextTrackEvent(int trackIndex, ScheduledEvent& ev) const
+{
+    const auto& ps = playState[(size_t)trackIndex];
+    bool found = false;
+    auto consider = [&](double ppq, EventType type) {
+        ScheduledEvent candidate { ppq, trackIndex, type, 0 };
+        if (!found || eventIsLater(ev, candidate)) ev = candidate;
+        found = true;
+    };
+    if (ps.lastNote != -1) consider(ps.noteOffPpq, EventType::NoteOff);
+    if (ps.hasPendingNote) consider(ps.pendingOnPpq, EventType::NoteOn);
+    double lanePpq = 0.0;
+    if (getLaneEventPpq(ps, lanePpq)) consider(lanePpq, EventType::Lane);
+    if (ps.active && !ps.stepHeld) consider(getStepEventPpq(ps), EventType::Step);
+    return found;
+}
+
+void SequencerEngine::holdStep(int trackIndex)
+{
+    // The step waits for the lock; the track stays queued for everything else it has due
+    auto& ps = playState[(size_t)trackIndex];
+    if (!ps.stepHeld) {
+        ps.stepHeld = true;
+        heldSteps[(size_t)numHeldSteps++] = trackIndex;
+    }
+    pushTrackEvent(trackIndex);
+}
+
+void SequencerEngine::releaseHeldSteps()
+{
+    if (numHeldSteps == 0) return;
+
+    // The held tracks' live entries are rewritten in place to include their step again, so
+    // the heap doesn't fill with superseded entries while the editor keeps the lock busy.
+    // Only after a block without the lock - one pass over the heap, then one re-heapify.
+    for (int i = 0; i < heapSize; ++i) {
+        auto& ev = eventHeap[(size_t)i];
+        auto& ps = playState[(size_t)ev.track];
+        if (!ps.stepHeld || ev.serial != ps.queuedSerial) continue;
+        ps.stepHeld = false;
+        const std::uint32_t serial = ev.serial;
+        getNextTrackEvent(ev.track, ev);
+        ev.serial = serial;
+    }
+    std::make_heap(eventHeap.begin(), eventHeap.begin() + heapSize, eventIsLater);
+
+    // Held tracks with nothing else queued
+    for (int i = 0; i < numHeldSteps; ++i) {
+        auto& ps = playState[(size_t)heldSteps[(size_t)i]];
+        if (!ps.stepHeld) continue;
+        ps.stepHeld = false;
+        pushTrackEvent(heldSteps[(size_t)i]);
+    }
+    numHeldSteps = 0;
+}
+
+bool SequencerEngine::eventIsLater(const ScheduledEvent& a, const ScheduledEvent& b)
+{
+    // Min-heap on time; at equal times note-offs go first so a retrigger isn't cut,
+    // lane points before note-ons so a note starts with its bend / CC, then note-ons so a note pushed late lands before the next step is decided
+    if (a.ppq != b.ppq) return a.ppq > b.ppq;
+    return (int)a.type > (int)b.type;
+}
+
+double SequencerEngine::getStepEventPpq(const TrackPlayState& ps)
+{
+    // Steps are decided MAX_STEP_OFFSET of a step ahead of their nominal time (lookahead)
+    return ((double)ps.nextStep - MAX_STEP_OFFSET) * ps.stepQuarters;
+}
+
+bool SequencerEngine::getLaneEventPpq(const TrackPlayState& ps, double& ppq)
+{
+    bool found = false;
+    if (ps.lane.active) {
+        ppq = ps.lane.startPpq + ps.lane.spanQuarters * ps.lane.hit / ps.lane.divisions;
+        found = true;
+    }
+    if (ps.queuedLane.active && (!found || ps.queuedLane.startPpq < ppq)) {
+        ppq = ps.queuedLane.startPpq;
+        found = true;
+    }
+    return found;
+}
+
+void SequencerEngine::advanceTrack(int trackIndex)
+{
+    auto& ps = playState[(size_t)trackIndex];
+    std::int64_t gridStep = ps.nextStep++;
+    double stepPpq = (double)gridStep * ps.stepQuarters;
+    int length = getTrackLength(trackIndex);
+    int playMode = scheduledPlayMode;
+
+    // Kept for recording, which may run in a block without the structure lock
+    ps.length = length;
+    ps.baseNote = trackIndex < (int)trackBaseNote.size() ? trackBaseNote[(size_t)trackIndex] : 60;
+
+    assert(!ps.hasDecidedStep || stepPpq > ps.decidedStepPpq); // A step is never decided twice
+    ps.hasDecidedStep = true;
+    ps.decidedStepPpq = stepPpq;
+    ps.stepIndexBeforeDecision = ps.stepIndex;
+    ps.decidedNoteStarted = false;
+
+    if (playMode == PlayModeLayer) {
+        // Every enabled track loops its own length against the host position (polymeter)
+        ps.stepIndex = (int)(gridStep % length);
+    }
+    else if (playMode == PlayModeSong) {
+        // Position comes straight from the host bar, so relocation lands on the right entry
+        double barQuarters = timeSignatureNumerator * 4.0 / std::max(1, timeSignatureDenominator);
+        int bar = (int)(songBarRef + (std::int64_t)std::floor((stepPpq - songBarRefPpq) / barQuarters + 1.0e-9));
+        int entryIndex = findArrangementEntry(bar);
+        currentSongBar = bar;
+        currentArrangementEntry = entryIndex;
+        ps.stepIndex = -1;
+        if (entryIndex < 0) return; // Before the first entry
+
+        const auto& entry = arrangement[(size_t)entryIndex];
+        if (entry.pattern >= getNumTracks()) return; // Deleted pattern: silence
+
+        if (entry.pattern != trackIndex) {
+            handOverTrack(trackIndex, entry.pattern, stepPpq);
+            return;
+        }
+
+        double entryStartPpq = songBarRefPpq + static_cast<double>(entry.startBar - songBarRef) * barQuarters;
+        std::int64_t stepInEntry = (std::int64_t)std::llround((stepPpq - entryStartPpq) / ps.stepQuarters);
+
+        // Past the entry's repeats (gap before the next entry): silence
+        if (stepInEntry < 0 || stepInEntry >= (std::int64_t)entry.repeats * length) return;
+
+        ps.stepIndex = (int)(stepInEntry % length);
+        ps.transpose = entry.transpose;
+    }
+    else {
+        // Advance to next step
+        ps.stepIndex++;
+
+        // Check if we finished a full sequence loop
+        if (ps.stepIndex >= length) {
+            ps.stepIndex = 0;
+
+            // We completed one full loop
+            barsPlayedOnCurrentTrack++;
+
+            // Track Switch Logic: Check if we've played enough loops
+            if (barsPlayedOnCurrentTrack >= trackRepeat[(size_t)trackIndex]) {
+                barsPlayedOnCurrentTrack = 0;
+
+                // Find next enabled track (wraps; stays put if no other track is enabled)
+                int nextTrack = trackEnabled.findNextWrapping(trackIndex, getNumTracks());
+                if (nextTrack >= 0 && nextTrack != trackIndex) {
+                    // The next track picks up on its own grid at (or just after) this boundary
+                    handOverTrack(trackIndex, nextTrack, stepPpq);
+                    return;
+                }
+            }
+        }
+    }
+
+    // Replace recording: wipe the shown track's steps as the playhead passes them (new input rewrites them)
+    if (trackIndex == currentTrack && settings.recordMode == RecordReplace && ps.stepIndex >= 0)
+        clearRecordedStep(trackIndex, ps.stepIndex);
+
+    // Steps past the stored length are empty - nothing to trigger
+    const auto& trackSteps = tracks[(size_t)trackIndex];
+    if (ps.stepIndex < 0 || ps.stepIndex >= (int)trackSteps.size()) return;
+
+    queueLaneSegment(trackIndex, trackSteps[(size_t)ps.stepIndex], gridStep);
+    triggerStep(trackIndex, trackSteps[(size_t)ps.stepIndex], gridStep);
+}
+
+double SequencerEngine::getOnsetPpq(std::int64_t gridStep, float offset, double stepQuarters)
+{
+    // In grid steps first: a step pushed late by MAX_STEP_OFFSET lands on exactly the same ppq as
+    // the next step's decision (where its note-on must still go first), not a rounding error before
+    return ((double)gridStep + std::clamp(offset, -MAX_STEP_OFFSET, MAX_STEP_OFFSET)) * stepQuarters;
+}
+
+void SequencerEngine::queueLaneSegment(int trackIndex, const Step& s, std::int64_t gridStep)
+{
+    // Lanes follow the step even when its note is off, tied or skipped by probability
+    bool anySet = false;
+    for (int value : s.lanes) anySet = anySet || value != LANE_OFF;
+    if (!anySet) return;
+
+    auto& ps = playState[(size_t)trackIndex];
+    TrackPlayState::LaneSegment seg;
+    seg.active = true;
+    seg.startPpq = getOnsetPpq(gridStep, s.offset, ps.stepQuarters);
+    seg.spanQuarters = ps.stepQuarters;
+    seg.channel = trackIndex < (int)trackChannel.size() ? std::clamp(trackChannel[(size_t)trackIndex], 1, 16) : 1;
+    seg.from = s.lanes;
+    seg.to.fill(LANE_OFF);
+
+    // Smoothing glides towards the next step's values, a fixed number of points per step
+    // (not per sample) so the output rate stays bounded whatever the tempo
+    static const int pointsPerStep[] = { 1, 4, 8, 16, 32 };
+    int smooth = std::clamp(settings.laneSmooth, 0, 4);
+    if (smooth > 0) {
+        const auto& trackSteps = tracks[(size_t)trackIndex];
+        int next = (ps.stepIndex + 1) % getTrackLength(trackIndex);
+        if (next < (int)trackSteps.size()) {
+            const auto& nextStep = trackSteps[(size_t)next];
+            bool glides = false;
+            for (int l = 0; l < NUM_LANES; ++l) {
+                if (s.lanes[(size_t)l] == LANE_OFF || nextStep.lanes[(size_t)l] == LANE_OFF) continue;
+                seg.to[(size_t)l] = nextStep.lanes[(size_t)l];
+                glides = glides || seg.to[(size_t)l] != seg.from[(size_t)l];
+            }
+            if (glides) seg.divisions = pointsPerStep[smooth];
+        }
+    }
+
+    // The previous step's segment may still be running - this one takes over when it starts
+    if (ps.lane.active) ps.queuedLane = seg;
+    else ps.lane = seg;
+}
+
+void SequencerEngine::triggerStep(int trackIndex, const Step& s, std::int64_t gridStep)
+{
+    if (!s.active) return;
+
+    // If it's a TIED step, we do NOT trigger a new note.
+    // We just let the previous note continue ringing (because its gate was long enough).
+    // NOTE: If the user ties steps but the "start" step wasn't set to a long gate, the note will cut off early.
+    // The Editor logic handles setting the start step gate.
+    if (s.isTied) return;
+
+    auto& ps = playState[(size_t)trackIndex];
+
+    // LFOs are sampled at this step's nominal onset
+    const ModulatedStep mod = modulateStep(s, (double)gridStep * ps.stepQuarters);
+
+    // Determine velocity and probability
+    if (audioRandom.nextFloat() > mod.prob) return;
+
+    // Output channel and base-note remap (C4 = 60 in the editor plays the track's base note)
+    int channel = trackIndex < (int)trackChannel.size() ? trackChannel[(size_t)trackIndex] : 1;
+    int baseNote = trackIndex < (int)trackBaseNote.size() ? trackBaseNote[(size_t)trackIndex] : 60;
+
+    int note = shiftInScale(s.note, mod.scaleDegrees) + 12 * mod.octaves;
+    ps.pendingNote = note + (baseNote - 60) + ps.transpose; // Octave is added (and range clamped) at note-on
+    ps.pendingChannel = std::clamp(channel, 1, 16); // Remember it - the off must go where the on went
+    ps.pendingVelocity = mod.velocity;
+
+    // Micro-timing: the note-on is queued at its shifted position, possibly in a later block.
+    // A step caught up late (start or relocation inside its early push) starts with the block,
+    // its ratchets and gate intact - not squeezed into a zero-length note at sample 0.
+    ps.pendingOnPpq = std::max(getOnsetPpq(gridStep, s.offset, ps.stepQuarters), blockTimeline.getPpqAt(0));
+
+    // Gate Length is applied per hit when the note-on fires (in quarters, so it follows tempo)
+    // Logic assumes s.gate is e.g. 5.0 for a long tie.
+    ps.pendingGate = mod.gate;
+
+    // Ratchets spread over this step's duration. A late-shifted step whose hits run into
+    // the next step is cut short by it (replacing the pending note drops the rest).
+    ps.ratchetStartPpq = ps.pendingOnPpq;
+    ps.ratchetStepQuarters = ps.stepQuarters;
+    ps.ratchetCount = std::clamp(s.ratchets, 1, MAX_RATCHETS);
+    ps.ratchetCurve = s.ratchetCurve;
+    ps.ratchetHit = 0;
+    ps.hasPendingNote = true;
+}
+
+SequencerEngine::ModulatedStep SequencerEngine::modulateStep(const Step& s, double stepPpq) const
+{
+    ModulatedStep mod;
+    mod.velocity = s.velocity;
+    mod.gate = s.gate;
+    mod.prob = s.prob;
+
+    for (int l = 0; l < NUM_LFOS; ++l) {
+        const auto& lfo = settings.lfos[(size_t)l];
+        if (lfo.target == LfoOff) continue;
+
+        double cycle = getLfoRateQuarters(lfo.rate);
+        float amount = (float)getLfoValue(l, lfo.shape, stepPpq, cycle) * lfo.depth * 0.01f;
+
+        switch (lfo.target) {
+            case LfoVelocity:    mod.velocity = std::clamp(mod.velocity + (int)std::lround(amount * 63.0f), 1, 127); break;
+            case LfoGate:        mod.gate = std::max(0.05f, mod.gate * (1.0f + amount)); break;
+            case LfoProbability: mod.prob = std::clamp(mod.prob + amount, 0.0f, 1.0f); break;
+            case LfoNote:        mod.scaleDegrees += (int)std::lround(amount * 7.0f); break; // Up to an octave of a 7-note scale
+            case LfoOctave:      mod.octaves += (int)std::lround(amount * 2.0f); break;
+            default: break;
+        }
+    }
+    return mod;
+}
+
+int SequencerEngine::shiftInScale(int note, int degrees) const
+{
+    if (degrees == 0) return note;
+
+    int root = settings.key;
+    int scale = settings.scale;
+    int direction = degrees > 0 ? 1 : -1;
+
+    // Walk note by note, counting only notes in the scale (every scale has one within 12 semitones)
+    for (int moved = 0; moved != degrees; moved += direction) {
+        int next = note + direction;
+        while (next >= 0 && next <= 127 && !isNoteInScale(next, root, scale)) next += direction;
+        if (next < 0 || next > 127) break;
+        note = next;
+    }
+    return note;
+}
+
+//==============================================================================
+int SequencerEngine::getTrackRate(int trackIndex) const
+{
+    int rate = (trackIndex >= 0 && trackIndex < (int)trackRate.size()) ? trackRate[(size_t)trackIndex] : -1;
+    if (rate < 0) rate = globalRate.load(); // Follow global
+    return rate;
+}
+
+double SequencerEngine::getTrackStepQuarters(int trackIndex) const
+{
+    return getRateQuarters(getTrackRate(trackIndex));
+}
+
+int SequencerEngine::getTrackLength(int trackIndex) const
+{
+    int length = (trackIndex >= 0 && trackIndex < (int)trackLength.size()) ? trackLength[(size_t)trackIndex] : 0;
+    if (length <= 0) length = globalNumSteps.load(); // Follow global
+    return std::clamp(length, 1, MAX_STEPS);
+}
+
+void SequencerEngine::setTrackRate(int trackIndex, int rateIndex)
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    if (trackIndex < 0 || trackIndex >= getNumTracks()) return;
+    trackRate[(size_t)trackIndex] = std::clamp(rateIndex, -1, NUM_RATES - 1);
+    scheduleDirty = true;
+}
+
+void SequencerEngine::setTrackLength(int trackIndex, int length)
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    if (trackIndex < 0 || trackIndex >= getNumTracks()) return;
+    trackLength[(size_t)trackIndex] = std::clamp(length, 0, MAX_STEPS);
+    scheduleDirty = true; // Steps decided early with the old length are decided again
+}
+
+void SequencerEngine::setTrackRepeat(int trackIndex, int repeat)
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    if (trackIndex < 0 || trackIndex >= getNumTracks()) return;
+    trackRepeat[(size_t)trackIndex] = std::max(1, repeat);
+}
+
+void SequencerEngine::setTrackChannel(int trackIndex, int channel)
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    if (trackIndex < 0 || trackIndex >= getNumTracks()) return;
+    trackChannel[(size_t)trackIndex] = std::clamp(channel, 1, 16);
+}
+
+void SequencerEngine::setTrackBaseNote(int trackIndex, int note)
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    if (trackIndex < 0 || trackIndex >= getNumTracks()) return;
+    trackBaseNote[(size_t)trackIndex] = std::clamp(note, 0, 127);
+}
+
+void SequencerEngine::setTrackEnabled(int trackIndex, bool enabled)
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    if (trackIndex < 0 || trackIndex >= getNumTracks()) return;
+    trackEnabled.set(trackIndex, enabled);
+    scheduleDirty = true;
+}
+
+//==============================================================================
+int SequencerEngine::findArrangementEntry(int bar) const
+{
+    // Entries are sorted by start bar: last entry starting at or before 'bar'
+    auto it = std::upper_bound(arrangement.begin(), arrangement.end(), bar,
+                               [](int b, const ArrangementEntry& e) { return b < e.startBar; });
+    return (int)(it - arrangement.begin()) - 1;
+}
+
+int SequencerEngine::getEntryLengthInBars(const ArrangementEntry& entry) const
+{
+    // Bars needed for 'repeats' loops of the pattern at its own rate / length
+    double barQuarters = timeSignatureNumerator * 4.0 / std::max(1, timeSignatureDenominator);
+    double entryQuarters = entry.repeats * getTrackLength(entry.pattern) * getTrackStepQuarters(entry.pattern);
+    return std::max(1, (int)std::ceil(entryQuarters / barQuarters - 1.0e-9));
+}
+
+void SequencerEngine::appendToArrangement(int pattern, int repeats, int transpose)
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    ArrangementEntry entry;
+    entry.pattern = pattern;
+    entry.repeats = std::max(1, repeats);
+    entry.transpose = transpose;
+    if (!arrangement.empty())
+        entry.startBar = arrangement.back().startBar + getEntryLengthInBars(arrangement.back());
+    arrangement.push_back(entry);
+}
+
+void SequencerEngine::removeArrangementEntry(int index)
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    if (index < 0 || index >= (int)arrangement.size()) return;
+
+    // Close the gap: later entries move up by the removed entry's span
+    int span = (index + 1 < (int)arrangement.size())
+                 ? arrangement[(size_t)index + 1].startBar - arrangement[(size_t)index].startBar
+                 : 0;
+    arrangement.erase(arrangement.begin() + index);
+    for (size_t i = (size_t)index; i < arrangement.size(); ++i)
+        arrangement[i].startBar -= span;
+}
+
+void SequencerEngine::setArrangementRepeats(int index, int repeats)
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    if (index < 0 || index >= (int)arrangement.size()) return;
+
+    auto& entry = arrangement[(size_t)index];
+    int oldLength = getEntryLengthInBars(entry);
+    entry.repeats = std::clamp(repeats, 1, 64);
+    int delta = getEntryLengthInBars(entry) - oldLength;
+
+    // Keep the following entries butted up against this one
+    for (size_t i = (size_t)index + 1; i < arrangement.size(); ++i)
+        arrangement[i].startBar += delta;
+}
+
+void SequencerEngine::setArrangementTranspose(int index, int transpose)
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    if (index < 0 || index >= (int)arrangement.size()) return;
+    arrangement[(size_t)index].transpose = std::clamp(transpose, -24, 24);
+}
+
+void SequencerEngine::clearArrangement()
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    arrangement.clear();
+}
+
+//==============================================================================
+SequencerEngine::Snapshot SequencerEngine::takeSnapshot()
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    return { tracks, trackRepeat, trackRate, trackLength, trackChannel, trackBaseNote, trackEnabled, arrangement };
+}
+
+void SequencerEngine::restoreSnapshot(Snapshot snapshot)
+{
+    const auto numTracks = snapshot.tracks.size();
+    assert(numTracks <= (size_t)MAX_TRACKS);
+    assert(snapshot.trackRepeat.size() == numTracks && snapshot.trackRate.size() == numTracks
+           && snapshot.trackLength.size() == numTracks && snapshot.trackChannel.size() == numTracks
+           && snapshot.trackBaseNote.size() == numTracks);
+
+    std::stable_sort(snapshot.arrangement.begin(), snapshot.arrangement.end(),
+                     [](const ArrangementEntry& a, const ArrangementEntry& b) { return a.startBar < b.startBar; });
+
+    const std::lock_guard<SpinLock> lock (structureLock);
+    if (numTracks > 0) {
+        tracks.swap(snapshot.tracks);
+        trackRepeat.swap(snapshot.trackRepeat);
+        trackRate.swap(snapshot.trackRate);
+        trackLength.swap(snapshot.trackLength);
+        trackChannel.swap(snapshot.trackChannel);
+        trackBaseNote.swap(snapshot.trackBaseNote);
+        std::swap(trackEnabled, snapshot.trackEnabled);
+        currentTrack = 0;
+        steps = &tracks[0];
+    }
+    arrangement.swap(snapshot.arrangement);
+    scheduleDirty = true;
+}
+
+//==============================================================================
+void SequencerEngine::randomizePattern(float amount, int rootNote, int scaleType)
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    randomizeSteps(steps->edit(), getTrackLength(currentTrack), amount, rootNote, scaleType, patternRandom);
+}
+
+void SequencerEngine::mutatePattern(float amount, int rootNote, int scaleType)
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    mutateSteps(steps->edit(), getTrackLength(currentTrack), amount, rootNote, scaleType, patternRandom);
+}
+
+void SequencerEngine::clearPattern()
+{
+    const std::lock_guard<SpinLock> lock (structureLock); // edit() may unshare the track
+    clearSteps(steps->edit());
+}
+
+void SequencerEngine::invertPattern()
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    invertSteps(steps->edit(), getTrackLength(currentTrack));
+}
+
+void SequencerEngine::reversePattern()
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    reverseSteps(steps->edit(), getTrackLength(currentTrack));
+}
+
+void SequencerEngine::euclideanPattern(int hits, int numSteps)
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    euclideanSteps(steps->edit(), hits, numSteps);
+}
+
+void SequencerEngine::switchToTrack(int trackIndex)
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    setCurrentTrack(trackIndex);
+}
+
+void SequencerEngine::setCurrentTrack(int trackIndex)
+{
+    if (trackIndex >= 0 && trackIndex < getNumTracks() && trackIndex != currentTrack) {
+        currentTrack = trackIndex;
+        steps = &tracks[(size_t)trackIndex]; // Update pointer
+        currentStepIndex = 0; // Reset step position when switching tracks
+    }
+}
+
+void SequencerEngine::setPattern(int trackIndex, SharedPattern pattern)
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    if (trackIndex < 0 || trackIndex >= getNumTracks()) return;
+    tracks[(size_t)trackIndex] = std::move(pattern); // The old steps are freed here, off the audio thread
+}
+
+const SequencerEngine::Step& SequencerEngine::getStep(int index) const
+{
+    static const Step empty = makeEmptyStep();
+    if (steps == nullptr || index < 0 || index >= (int)steps->size()) return empty;
+    return (*steps)[(size_t)index];
+}
+
+SequencerEngine::Step& SequencerEngine::getStepForEdit(int index)
+{
+    index = std::clamp(index, 0, MAX_STEPS - 1);
+    auto& track = steps->edit(); // Copy-on-write: a shared pattern is unshared before the first write
+    ensureTrackLength(track, index + 1);
+    return track[(size_t)index];
+}
+
+void SequencerEngine::addTrack()
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    if (getNumTracks() >= MAX_TRACKS) return;
+
+    tracks.push_back(SharedPattern(SharedPattern::Steps((size_t)DEFAULT_TRACK_LENGTH, makeEmptyStep())));
+    trackRepeat.push_back(1);
+    trackRate.push_back(-1);  // Follow global rate
+    trackLength.push_back(0); // Follow global length
+    trackChannel.push_back(1);
+    trackBaseNote.push_back(60); // No remap
+    trackEnabled.set(getNumTracks() - 1, true);
+    scheduleDirty = true;
+
+    // Update steps pointer after reallocation
+    if (currentTrack < (int)tracks.size()) {
+        steps = &tracks[(size_t)currentTrack.load()];
+    }
+}
+
+void SequencerEngine::duplicateTrack(int sourceIndex)
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    if (sourceIndex < 0 || sourceIndex >= getNumTracks() || getNumTracks() >= MAX_TRACKS) return;
+
+    // Copy before push_back - the source reference would dangle on reallocation. The steps
+    // themselves are shared until one of the two tracks is edited.
+    SharedPattern newTrack = tracks[(size_t)sourceIndex];
+    int repeat = trackRepeat[(size_t)sourceIndex];
+    int rate = trackRate[(size_t)sourceIndex];
+    int length = trackLength[(size_t)sourceIndex];
+    int channel = trackChannel[(size_t)sourceIndex];
+    int baseNote = trackBaseNote[(size_t)sourceIndex];
+
+    tracks.push_back(std::move(newTrack));
+    trackRepeat.push_back(repeat);
+    trackRate.push_back(rate);
+    trackLength.push_back(length);
+    trackChannel.push_back(channel);
+    trackBaseNote.push_back(baseNote);
+    trackEnabled.set(getNumTracks() - 1, true);
+    scheduleDirty = true;
+
+    // Update steps pointer after reallocation
+    steps = &tracks[(size_t)currentTrack.load()];
+}
+
+void SequencerEngine::removeTrack()
+{
+    const std::lock_guard<SpinLock> lock (structureLock);
+    if (tracks.size() > 1) {
+        trackEnabled.set(getNumTracks() - 1, false); // Bits past the last track stay clear
+        tracks.pop_back();
+        trackRepeat.pop_back();
+        trackRate.pop_back();
+        trackLength.pop_back();
+        trackChannel.pop_back();
+        trackBaseNote.pop_back();
+        scheduleDirty = true;
+
+        // Make sure currentTrack is still valid
+        if (currentTrack >= (int)tracks.size()) {
+            currentTrack = (int)tracks.size() - 1;
+        }
+
+        // Update steps pointer after removal
+        steps = &tracks[(size_t)currentTrack.load()];
+    }
+}
@@ -0,0 +1,424 @@
+/*
+  ==============================================================================
+    SequencerEngine.h
+    Track playback and event scheduling - no JUCE dependency
+  ==============================================================================
+*/
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "SequencerCore.h"
+#include "PatternStore.h"
+#include "TrackBitset.h"
+#include "SoundingNoteTable.h"
+#include "BlockTimeline.h"
+#include "MidiEventBuffer.h"
+#include "SpinLock.h"
+
+// The sequencer itself: the tracks and arrangement, and the scheduler that turns them into
+// MIDI one block at a time. Plain C++ - the plugin feeds it the host's transport and MIDI
+// input and copies its output to the host buffer, and any other host can do the same:
+//
+//     engine.prepare(sampleRate, maxBlockSize);
+//     engine.setSettings(settings);                       // Every block, from your parameters
+//     for (const auto& e : engine.process(numSamples, transport, input, numInput)) ...
+//
+// Threads: process() / setSettings() / processBypassed() run on the audio thread. The
+// track and arrangement editors below run on the message thread and take structureLock;
+// the audio thread only try-locks it and defers whatever needs the structure to the next
+// block, so it never waits on an edit.
+class SequencerEngine
+{
+public:
+    using Step = SequencerCore::Step;
+
+    static constexpr int MAX_TRACKS = 512;
+    static constexpr int MAX_VOICES_PER_CHANNEL = 32; // "voiceLimit" range
+
+    // "playMode" choices: Chain = round-robin of enabled tracks, Song = arrangement, Layer = all enabled tracks at once
+    enum PlayMode { PlayModeChain = 0, PlayModeSong, PlayModeLayer };
+
+    // MIDI input choices ("inputMode", "inputHold", "inputApply")
+    enum InputMode { InputOff = 0, InputTranspose, InputKey };
+    enum InputHoldMode { InputLatch = 0, InputHold, InputGate };
+    enum InputApply { InputApplyNextStep = 0, InputApplyImmediate };
+
+    // "recordMode" choices
+    enum RecordMode { RecordOff = 0, RecordOverdub, RecordReplace };
+
+    // Everything a block reads from the host's parameters, handed over once per block
+    struct Settings {
+        int playMode = PlayModeChain;
+        int key = 0;                // 0 = C
+        int scale = 0;              // SequencerCore::isNoteInScale scale type
+        int octave = 0;
+        int voiceLimit = 16;        // Notes per channel
+        int voiceSteal = 0;         // 0 = oldest, 1 = quietest
+        int laneCc = 1;             // CC number the CC lane drives
+        int laneSmooth = 0;         // 0 = one value per step, 1..4 = 4..32 points per step
+        int inputMode = InputOff;
+        int inputHold = InputLatch;
+        int inputApply = InputApplyNextStep;
+        int recordMode = RecordOff;
+        struct Lfo { int shape = 0; int rate = 2; int target = SequencerCore::LfoOff; float depth = 50.0f; };
+        std::array<Lfo, SequencerCore::NUM_LFOS> lfos {};
+    };
+
+    // Where the block is in musical time - the host's play head, or a MIDI clock follower
+    struct Transport {
+        bool isPlaying = false;
+        bool hasPosition = false;   // false: carries on from the last block's end
+        double ppq = 0.0;           // Block start, in quarter notes
+        double bpm = 120.0;
+        bool hasTimeSignature = false;
+        int numerator = 4;
+        int denominator = 4;
+        bool hasBar = false;        // Host bar numbering (song mode): bar 'barCount' starts at 'barStartPpq'
+        std::int64_t barCount = 0;
+        double barStartPpq = 0.0;
+        bool estimateRamp = true;   // Infer tempo ramps from consecutive blocks (off when the position is already steered)
+        int stopOffset = -1;        // Transport stops at this sample within the block (-1 = doesn't)
+    };
+
+    // A block's output, in sample order - a view of the engine's buffer, valid until the next block
+    struct EventSpan {
+        const MidiEvent* first = nullptr;
+        const MidiEvent* last = nullptr;
+        const MidiEvent* begin() const { return first; }
+        const MidiEvent* end() const { return last; }
+        int size() const { return (int)(last - first); }
+    };
+
+    // What the last block did (telemetry)
+    struct BlockInfo {
+        int stepsCrossed = 0;           // Step decisions made
+        float maxOnsetError = 0.0f;     // Largest |sent - exact| event position, in samples
+    };
+
+    // Events that don't fit the output buffer (audio thread, same order as the span)
+    using OverflowHandler = void (*) (void* context, const std::uint8_t* data, int numBytes, int sampleOffset);
+
+    SequencerEngine();
+
+    //==============================================================================
+    // Playback
+    void prepare(double sampleRate, int maxBlockSize);  // Not while process() runs
+    void setOverflowHandler(OverflowHandler handler, void* context);
+    int getOutputCapacity() const { return output.capacity(); }
+
+    void setSettings(const Settings& newSettings);      // Audio thread, before process()
+    EventSpan process(int numSamples, const Transport& transport, const MidiEvent* input = nullptr, int numInput = 0);
+    EventSpan processBypassed();                        // Releases everything; playback picks up fresh afterwards
+    void releaseNotesOnNextBlock() { releaseNotesPending = true; } // Any thread - e.g. releaseResources
+    const BlockInfo& getBlockInfo() const { return blockInfo; }
+
+    // Global step count / rate that tracks follow when their own is 0 / -1 (any thread)
+    void setGlobalNumSteps(int numSteps) { globalNumSteps = numSteps; }
+    void setGlobalRate(int rateIndex) { globalRate = rateIndex; }
+
+    //==============================================================================
+    // Pattern data (message thread edits, under structureLock)
+    std::vector<SharedPattern> tracks; // Dynamic list of tracks (shared until edited - see PatternStore)
+    std::vector<int> trackRepeat; // How many times to repeat each track before moving to next
+    TrackBitset<MAX_TRACKS> trackEnabled; // Which tracks are active (word-packed, O(1) count)
+    std::atomic<int> currentTrack { 0 };     // Also moved by playback (chain / song hand-over)
+    SharedPattern* steps = nullptr; // Pointer to current track for easy switching (edit() to write)
+    std::atomic<int> currentStepIndex { 0 }; // Written by the audio thread, read by the editor
+    std::atomic<bool> isPlaying { false };
+
+    SpinLock structureLock;
+
+    void setPattern(int trackIndex, SharedPattern pattern);
+    const SharedPattern& getPattern(int trackIndex) const { return tracks[(size_t)trackIndex]; }
+
+    // Step access for the editor - storage only grows for steps that are actually edited
+    const Step& getStep(int index) const;   // Steps past the stored length read as empty
+
+    // Runs edit(Step&) on a step of the current track under the structure lock, growing its
+    // storage as needed. The reference is only valid inside the call.
+    template <typename EditFn>
+    void editStep(int index, EditFn&& edit)
+    {
+        const std::lock_guard<SpinLock> lock (structureLock);
+        edit(getStepForEdit(index));
+    }
+
+    // Helper to add/remove tracks
+    void addTrack();
+    void removeTrack();
+    void duplicateTrack(int sourceIndex); // Appends a copy of sourceIndex
+    int getNumTracks() const { return (int)tracks.size(); }
+    void switchToTrack(int trackIndex);
+
+    // Enabled state
+    void setTrackEnabled(int trackIndex, bool enabled);
+    bool isTrackEnabled(int trackIndex) const { return trackEnabled.test(trackIndex); }
+    int getNumEnabledTracks() const { return trackEnabled.count(); }
+
+    // Per-track rate and length (polymeter). -1 / 0 = follow the global rate / step count.
+    std::vector<int> trackRate;
+    std::vector<int> trackLength;
+    void setTrackRate(int trackIndex, int rateIndex);
+    void setTrackLength(int trackIndex, int length);
+    void setTrackRepeat(int trackIndex, int repeat);
+    int getTrackRate(int trackIndex) const;          // Resolved rate index
+    double getTrackStepQuarters(int trackIndex) const;
+    int getTrackLength(int trackIndex) const;        // Resolved length in steps
+
+    // Per-track MIDI output: channel 1-16 and base note (step note 60 plays this note; 60 = no remap)
+    std::vector<int> trackChannel;
+    std::vector<int> trackBaseNote;
+    void setTrackChannel(int trackIndex, int channel);
+    void setTrackBaseNote(int trackIndex, int note);
+
+    // Time Signature from Host
+    int timeSignatureNumerator = 4;
+    int timeSignatureDenominator = 4;
+
+    // Track switching
+    int barsPlayedOnCurrentTrack = 0;
+    int beatsPlayedInCurrentBar = 0;
+
+    // Song / arrangement mode: a compact timeline of pattern references walked by host bar
+    struct ArrangementEntry {
+        int pattern = 0;    // Track index
+        int repeats = 1;    // Pattern loops
+        int transpose = 0;  // Semitones
+        int startBar = 0;   // 0-based bar where the entry starts
+    };
+    std::vector<ArrangementEntry> arrangement; // Sorted by startBar
+    std::atomic<int> currentArrangementEntry { -1 }; // Entry under the playhead (-1 = none)
+    std::atomic<int> currentSongBar { 0 };
+
+    int findArrangementEntry(int bar) const;   // O(log n); -1 before the first entry
+    int getEntryLengthInBars(const ArrangementEntry& entry) const;
+    void appendToArrangement(int pattern, int repeats, int transpose = 0);
+    void removeArrangementEntry(int index);
+    void setArrangementRepeats(int index, int repeats);
+    void setArrangementTranspose(int index, int transpose); // Semitones, -24 .. 24
+    void clearArrangement();
+
+    // The tracks and arrangement as saved and restored with the plugin state. takeSnapshot()
+    // copies them under the structure lock (patterns are shared, not copied); restoreSnapshot()
+    // only swaps a prepared snapshot in under it. Empty tracks keep the current ones.
+    struct Snapshot {
+        std::vector<SharedPattern> tracks;
+        std::vector<int> trackRepeat, trackRate, trackLength, trackChannel, trackBaseNote;
+        TrackBitset<MAX_TRACKS> trackEnabled;
+        std::vector<ArrangementEntry> arrangement;
+    };
+    Snapshot takeSnapshot();
+    void restoreSnapshot(Snapshot snapshot); // The replaced containers are freed after the lock
+
+    // Generative Functions (current track)
+    void randomizePattern(float amount, int rootNote, int scaleType); // amount: 0.0 to 1.0
+    void mutatePattern(float amount, int rootNote, int scaleType);    // amount: 0.0 to 1.0
+    void clearPattern();                        // Reset all steps to default
+    void invertPattern();                       // Flip active/inactive states
+    void reversePattern();                      // Reverse step order
+    void euclideanPattern(int hits, int steps); // Euclidean rhythm generator
+
+    // Step recording: the audio thread queues edits, applyRecordedEdits() writes them on the message thread
+    int applyRecordedEdits();                  // Number applied
+    std::atomic<int> recordedEditCount { 0 }; // Bumped when recorded steps land in the pattern
+    std::atomic<int> droppedRecordEdits { 0 }; // Recorded edits lost to a full queue (message thread stalled)
+
+private:
+    Settings settings;
+    std::atomic<int> globalNumSteps { 16 };
+    std::atomic<int> globalRate { 2 };
+
+    // Timing state
+    double sampleRate = 44100.0;
+    double currentBPM = 120.0;
+
+    // Musical time (quarter notes)
+    double internalPpq = 0.0;            // Used when the host reports no ppq position
+    double expectedBlockStartPpq = 0.0;  // Where the next block should start - detects relocation
+    BlockTimeline blockTimeline;         // ppq <-> sample mapping for the current block
+
+    // Tempo ramp estimate: last block's start, tempo and length
+    double lastBlockStartPpq = 0.0;
+    double lastBlockQuartersPerSample = 0.0;
+    int lastBlockNumSamples = 0;
+    double estimateTempoRamp(double blockStartPpq, double quartersPerSample, bool contiguous) const;
+
+    std::int64_t songBarRef = 0;          // Song mode: bar 'songBarRef' starts at 'songBarRefPpq'
+    double songBarRefPpq = 0.0;
+
+    // Per-track playback state (audio thread only). Each track runs its own absolute
+    // grid: step n starts at n * stepQuarters.
+    struct TrackPlayState {
+        bool active = false;        // Stepping (chain/song: the playing track, layer: enabled tracks)
+        std::int64_t nextStep = 0;  // Next grid step still to be scheduled
+        double stepQuarters = 0.25;
+        int stepIndex = -1;         // Step within the pattern
+        int transpose = 0;          // Song entry transpose
+
+        // Last step decided by the lookahead - a settings change before it starts decides it again
+        bool hasDecidedStep = false;
+        double decidedStepPpq = 0.0;    // Nominal start
+        int stepIndexBeforeDecision = -1;
+        bool decidedNoteStarted = false;
+        int lastNote = -1;          // Note State (monophonic per track)
+        int lastChannel = 1;        // Channel lastNote was sent on
+        int lastBaseNote = 60;      // lastNote before the MIDI-input transpose
+
+        // Note decided at the step event, waiting for its micro-timed note-on (or next ratchet hit)
+        bool hasPendingNote = false;
+        double pendingOnPpq = 0.0;
+        float pendingGate = 0.5f;
+        int pendingNote = 60;
+        int pendingChannel = 1;
+        int pendingVelocity = 100;
+        double ratchetStartPpq = 0.0;
+        double ratchetStepQuarters = 0.25; // Length of the step the hits spread over (a rate edit doesn't move them)
+        int ratchetCount = 1;
+        int ratchetCurve = 0;
+        int ratchetHit = 0;         // Next hit to play
+        double noteOffPpq = 0.0;
+
+        // Automation lanes: the step's segment is sent at 'divisions' points across it, gliding
+        // towards the next step's values. The next step is decided half a step early, so its
+        // segment waits in 'queuedLane' until this one ends (or it starts first, micro-timed).
+        struct LaneSegment {
+            bool active = false;
+            double startPpq = 0.0;
+            double spanQuarters = 0.25;
+            int divisions = 1;
+            int hit = 0;            // Next point to send
+            int channel = 1;
+            std::array<int, SequencerCore::NUM_LANES> from {};
+            std::array<int, SequencerCore::NUM_LANES> to {};
+        };
+        LaneSegment lane;
+        LaneSegment queuedLane;
+
+        std::uint32_t queuedSerial = 0; // Serial of the track's latest heap entry - older ones are superseded
+        bool stepHeld = false;      // Next step waits for a block with the structure lock
+
+        int length = 16;            // As of the last step decided (recording reads these without the lock)
+        int baseNote = 60;
+    };
+    std::array<TrackPlayState, MAX_TRACKS> playState;
+
+    // Min-heap of next events, one live entry per track (its note-off, pending note-on or
+    // next step, whichever is first). A block pops only the events that fall inside it.
+    enum class EventType { NoteOff, Lane, NoteOn, Step }; // Order = priority at equal times
+    struct ScheduledEvent { double ppq = 0.0; int track = 0; EventType type = EventType::Step; std::uint32_t serial = 0; };
+    std::array<ScheduledEvent, MAX_TRACKS * 2> eventHeap;
+    int heapSize = 0;
+    static bool eventIsLater(const ScheduledEvent& a, const ScheduledEvent& b);
+    static double getStepEventPpq(const TrackPlayState& ps);
+    static bool getLaneEventPpq(const TrackPlayState& ps, double& ppq); // false if no lane point is due
+
+    std::atomic<bool> scheduleDirty { true }; // Set by the message thread on track edits
+    int scheduledPlayMode = PlayModeChain;
+    int scheduledGlobalRate = -1;
+    int scheduledNumSteps = -1;
+    int scheduledChainTrack = 0;
+    bool pendingRebuild = false;     // A rebuild had to wait for the structure lock
+    bool pendingRebuildKill = false;
+    bool pendingChainRewind = false; // Stopped without the lock: back to the first track next block
+
+    // Blocks without the lock hold step decisions back; the tracks are requeued with the lock
+    std::array<int, MAX_TRACKS> heldSteps {};
+    int numHeldSteps = 0;
+    void holdStep(int trackIndex);
+    void releaseHeldSteps();
+
+    Step& getStepForEdit(int index); // editStep's target; the caller holds structureLock
+
+    // Everything a block sends, in time order; the caller reads it in place
+    MidiEventBuffer output;
+    OverflowHandler overflowHandler = nullptr;
+    void* overflowContext = nullptr;
+    BlockInfo blockInfo;
+    int getMaxOutputEvents(int samplesPerBlock) const;
+    static constexpr int MAX_OUTPUT_EVENTS = 32768;
+    void send(int sampleOffset, std::uint8_t status, int data1, int data2 = -1); // data2 < 0: two-byte message
+    void send(const MidiEvent& event);
+
+    // Every note we hold on, so nothing can be left hanging
+    using NoteTable = SoundingNoteTable<16, MAX_VOICES_PER_CHANNEL>;
+    NoteTable soundingNotes;
+    std::atomic<bool> releaseNotesPending { false }; // Set by releaseNotesOnNextBlock, handled by the next block
+
+    void startNote(int trackIndex, int channel, int note, int velocity, double endPpq, int sampleOffset);
+    void stopNote(int channel, int note, int sampleOffset);
+    void releaseVoice(int channel, int slot, int sampleOffset);
+    void releaseAllNotes(int sampleOffset);
+    void stopPlayback(int sampleOffset);
+    void dropScheduledNotes(int sampleOffset); // A killing rebuild's note release, without the lock
+    void stopTransport(int sampleOffset, bool rewindChain); // Stop + back to step 1
+
+    // Last value sent per channel and lane - repeats are dropped to keep the MIDI stream thin
+    std::array<std::array<int, SequencerCore::NUM_LANES>, 16> laneSent;
+    void sendLanePoint(TrackPlayState& ps, int sampleOffset);
+    void resetLanes(int sampleOffset);
+
+    // MIDI input transposition (audio thread)
+    std::array<int, 16> heldInputNotes {};
+    int numHeldInputNotes = 0;
+    int inputTranspose = 0;                 // Semitones, applied at note-on
+
+    // Step recording: single producer (audio thread), single consumer (applyRecordedEdits) ring
+    struct RecordEvent {
+        enum Type { Note, Gate, Clear };
+        Type type = Note;
+        int track = 0;
+        int index = 0;
+        int count = 1;      // Clear: steps from index on
+        int note = 60;
+        int velocity = 100;
+        float gate = 0.5f;
+    };
+    static constexpr int RECORD_FIFO_SIZE = 512;
+    std::array<RecordEvent, RECORD_FIFO_SIZE> recordBuffer;
+    std::atomic<int> recordWrite { 0 };
+    std::atomic<int> recordRead { 0 };
+    RecordEvent pendingClear;               // Replace recording: the steps passed so far, sent as one range
+    bool hasPendingClear = false;
+
+    struct RecordingNote { bool active = false; int track = 0; int index = 0; double startPpq = 0.0; double stepQuarters = 0.25; };
+    std::array<RecordingNote, 128> recordingNotes; // Keys held while recording, by input note
+    bool recordTimingValid = false;
+
+    void recordInputNote(int note, int velocity, bool isNoteOn, int sampleOffset);
+    void pushRecordEvent(const RecordEvent& ev);
+    void clearRecordedStep(int trackIndex, int stepIndex); // Extends the pending range or starts a new one
+    void flushRecordClear();
+
+    int getInputTranspose() const;          // 0 when MIDI input is off
+    bool isInputGateClosed() const;         // Gate mode with no key held
+    void handleInputMidi(const MidiEvent& event);
+
+    void rebuildSchedule(double fromPpq, bool killNotes);
+    void setCurrentTrack(int trackIndex); // switchToTrack without the lock (caller holds it)
+    void activateTrack(int trackIndex, double fromPpq);
+    static void retractDecision(TrackPlayState& ps, double fromPpq);
+    void handOverTrack(int fromTrack, int toTrack, double atPpq);
+    void pushTrackEvent(int trackIndex);
+    void compactEventHeap(); // Drops superseded entries when the heap is full
+    bool getNextTrackEvent(int trackIndex, ScheduledEvent& ev) const; // false if nothing is due
+    void advanceTrack(int trackIndex);
+    void triggerStep(int trackIndex, const Step& s, std::int64_t gridStep);
+    SequencerCore::Random audioRandom;   // Probability rolls (audio thread)
+    SequencerCore::Random patternRandom; // Generative edits (message thread)
+    void queueLaneSegment(int trackIndex, const Step& s, std::int64_t gridStep);
+    static double getOnsetPpq(std::int64_t gridStep, float offset, double stepQuarters); // Micro-timed start of a step
+
+    // A step's values after LFO modulation at its onset
+    struct ModulatedStep {
+        int velocity = 100;
+        float gate = 0.5f;
+        float prob = 1.0f;
+        int scaleDegrees = 0;   // Note moves along the "key" / "scale"
+        int octaves = 0;
+    };
+    ModulatedStep modulateStep(const Step& s, double stepPpq) const;
+    int shiftInScale(int note, int degrees) const;
+};
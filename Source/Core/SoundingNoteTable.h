@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+    SoundingNoteTable.h
+    Fixed-capacity table of notes currently held on, per MIDI channel
+  ==============================================================================
+*/
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Every note-on the sequencer sends is recorded here until its note-off goes out,
+// so stop / seek / bypass can release exactly what is sounding (no CC123) and a
+// per-channel voice limit can steal the oldest or quietest note. Voices are kept
+// packed per channel - lookups only touch the notes actually held. No allocation,
+// safe on the audio thread.
+template <int NumChannels, int MaxVoices>
+class SoundingNoteTable
+{
+public:
+    struct Voice
+    {
+        int note = 0;
+        int velocity = 0;
+        int track = -1;       // Track that started it
+        double endPpq = 0.0;  // Scheduled note-off time
+        uint32_t age = 0;     // Start order (lower = older)
+    };
+
+    enum class StealMode { Oldest, Quietest };
+
+    int count(int channel) const { return isValidChannel(channel) ? counts[index(channel)] : 0; }
+    int total() const { return numHeld; }
+
+    const Voice& get(int channel, int slot) const { return voices[index(channel)][(std::size_t)slot]; }
+
+    // Slot holding 'note' on 'channel', or -1
+    int find(int channel, int note) const
+    {
+        if (!isValidChannel(channel)) return -1;
+        const auto& held = voices[index(channel)];
+        for (int i = 0; i < counts[index(channel)]; ++i)
+            if (held[(std::size_t)i].note == note) return i;
+        return -1;
+    }
+
+    // Voice to give up when 'channel' already holds 'limit' notes, or -1 if there is room
+    int findVictim(int channel, int limit, StealMode mode) const
+    {
+        if (!isValidChannel(channel) || counts[index(channel)] < clampLimit(limit)) return -1;
+
+        const auto& held = voices[index(channel)];
+        int victim = 0;
+        for (int i = 1; i < counts[index(channel)]; ++i) {
+            const Voice& v = held[(std::size_t)i];
+            const Voice& best = held[(std::size_t)victim];
+            bool better = (mode == StealMode::Quietest)
+                            ? (v.velocity < best.velocity || (v.velocity == best.velocity && v.age < best.age))
+                            : (v.age < best.age);
+            if (better) victim = i;
+        }
+        return victim;
+    }
+
+    // Caller makes room first (find / findVictim + remove); returns false if the channel is full
+    bool add(int channel, int note, int velocity, int track, double endPpq)
+    {
+        if (!isValidChannel(channel) || counts[index(channel)] >= MaxVoices) return false;
+
+        Voice& v = voices[index(channel)][(std::size_t)counts[index(channel)]++];
+        v.note = note;
+        v.velocity = velocity;
+        v.track = track;
+        v.endPpq = endPpq;
+        v.age = nextAge++;
+        numHeld++;
+        return true;
+    }
+
+    void remove(int channel, int slot)
+    {
+        if (!isValidChannel(channel) || slot < 0 || slot >= counts[index(channel)]) return;
+
+        auto& held = voices[index(channel)];
+        held[(std::size_t)slot] = held[(std::size_t)(counts[index(channel)] - 1)]; // Swap-remove keeps it packed
+        counts[index(channel)]--;
+        numHeld--;
+    }
+
+    void clear()
+    {
+        counts.fill(0);
+        numHeld = 0;
+    }
+
+private:
+    static bool isValidChannel(int channel) { return channel >= 1 && channel <= NumChannels; }
+    static std::size_t index(int channel) { return (std::size_t)(channel - 1); }
+    static int clampLimit(int limit) { return limit < 1 ? 1 : (limit > MaxVoices ? MaxVoices : limit); }
+
+    std::array<std::array<Voice, (std::size_t)MaxVoices>, (std::size_t)NumChannels> voices {};
+    std::array<int, (std::size_t)NumChannels> counts {};
+    int numHeld = 0;
+    uint32_t nextAge = 0;
+};
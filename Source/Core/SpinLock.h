@@ -0,0 +1,31 @@
+/*
+  ==============================================================================
+    SpinLock.h
+    Minimal spin lock for the structure lock - no JUCE dependency
+  ==============================================================================
+*/
+
+#pragma once
+#include <atomic>
+#include <thread>
+
+// Guards the track / arrangement containers between the message thread (lock) and the audio
+// thread (try_lock only - it never waits). Holds are a few container operations long, so the
+// message thread spins, yielding, rather than sleeping. Works with std::lock_guard and
+// std::unique_lock (std::try_to_lock).
+class SpinLock
+{
+public:
+    void lock() noexcept
+    {
+        while (flag.test_and_set(std::memory_order_acquire))
+            std::this_thread::yield();
+    }
+
+    bool try_lock() noexcept { return !flag.test_and_set(std::memory_order_acquire); }
+
+    void unlock() noexcept { flag.clear(std::memory_order_release); }
+
+private:
+    std::atomic_flag flag = ATOMIC_FLAG_INIT;
+};
@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+    TrackBitset.h
+    Word-packed per-track flags with find-next-set-bit lookup
+  ==============================================================================
+*/
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+ #include <intrin.h>
+#endif
+
+// Fixed-capacity bitset used for track enabled state. Keeps a running count of
+// set bits and finds the next set bit a word (64 tracks) at a time, so lookups
+// stay cheap with hundreds of mostly-disabled tracks. No allocation - safe to
+// query from the audio thread.
+template <int NumBits>
+class TrackBitset
+{
+public:
+    static const int capacity = NumBits;
+
+    bool test(int index) const
+    {
+        if (index < 0 || index >= NumBits) return false;
+        return (words[(std::size_t)(index >> 6)] >> (index & 63)) & 1u;
+    }
+
+    void set(int index, bool value)
+    {
+        if (index < 0 || index >= NumBits || test(index) == value) return;
+
+        const uint64_t bit = uint64_t(1) << (index & 63);
+        if (value) { words[(std::size_t)(index >> 6)] |= bit;  numSet++; }
+        else       { words[(std::size_t)(index >> 6)] &= ~bit; numSet--; }
+    }
+
+    void clear()
+    {
+        words.fill(0);
+        numSet = 0;
+    }
+
+    int count() const { return numSet; }
+
+    // First set bit in [begin, end), or -1
+    int findFirst(int begin, int end) const
+    {
+        if (begin < 0) begin = 0;
+        if (end > NumBits) end = NumBits;
+
+        for (int w = begin >> 6; (w << 6) < end; ++w) {
+            uint64_t word = words[(std::size_t)w];
+            if ((w << 6) < begin) word &= ~uint64_t(0) << (begin & 63); // Mask bits below begin
+            if (word != 0) {
+                int index = (w << 6) + countTrailingZeros(word);
+                return index < end ? index : -1;
+            }
+        }
+        return -1;
+    }
+
+    // Next set bit after 'from', wrapping around within [0, size).
+    // Returns 'from' itself if it is the only set bit, -1 if none are set.
+    int findNextWrapping(int from, int size) const
+    {
+        if (numSet == 0 || size <= 0) return -1;
+
+        int next = findFirst(from + 1, size);
+        if (next < 0) next = findFirst(0, from + 1);
+        return next;
+    }
+
+private:
+    static int countTrailingZeros(uint64_t word)
+    {
+       #if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return (int)index;
+       #else
+        return __builtin_ctzll(word);
+       #endif
+    }
+
+    std::array<uint64_t, (std::size_t)((NumBits + 63) / 64)> words {};
+    int numSet = 0;
+};
@@ -8,8 +8,10 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
-// Macro for accessing steps (handles pointer)
-#define STEPS (*audioProcessor.steps)
+// Step access: reads past the stored length see an empty step, edits grow the track
+// (engine.editStep applies them under the structure lock)
+#define STEP_AT(i) engine.getStep(i)
+using Step = SequencerEngine::Step;
 
 //==============================================================================
 // Minimal "Null" Look - Clean Vector Knobs
@@ -94,6 +96,7 @@ void StepSequencerAudioProcessorEditor::DarkLookAndFeel::drawLinearSlider(
         auto name = slider.getName();
         juce::Colour fillColor = juce::Colour(0xff00ccff); // Cyan
         if (name.contains("Prob")) fillColor = juce::Colour(0xff00ff88); // Green
+        if (name.contains("Lane")) fillColor = juce::Colour(0xffcc66ff); // Violet
         
         // Use darker colors for unselected/inactive? 
         // Logic handled by opacity in component usually, but here fixed colors.
@@ -114,13 +117,13 @@ void StepSequencerAudioProcessorEditor::DarkLookAndFeel::drawLinearSlider(
 
 //==============================================================================
 StepSequencerAudioProcessorEditor::StepSequencerAudioProcessorEditor (StepSequencerAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
+    : AudioProcessorEditor (&p), audioProcessor (p), engine (p.engine)
 {
     setLookAndFeel(&darkLookAndFeel);
     
     // === CONTROL KNOBS (Top Row) ===
     
-    // Steps Knob (preset positions: 4, 8, 12, 16, 20, 24, 28, 32)
+    // Steps Knob (1 - 1024, type a value for long patterns)
     addAndMakeVisible(numStepsLabel);
     numStepsLabel.setText("Steps", juce::dontSendNotification);
     numStepsLabel.setJustificationType(juce::Justification::centred);
@@ -128,9 +131,9 @@ StepSequencerAudioProcessorEditor::StepSequencerAudioProcessorEditor (StepSequen
     addAndMakeVisible(numStepsKnob);
     numStepsKnob.setSliderStyle(juce::Slider::RotaryVerticalDrag);
     numStepsKnob.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 50, 20);
-    numStepsKnob.setRange(4, 32, 4);
-    numStepsKnob.setMouseDragSensitivity(100);
-    numStepsAttachment.reset(new juce::AudioProcessorValueTreeState::SliderAttachment(p.apvts, "numSteps", numStepsKnob));
+    numStepsKnob.setRange(1, SequencerCore::MAX_STEPS, 1);
+    numStepsKnob.setMouseDragSensitivity(400);
+    numStepsAttachment.reset(new juce::AudioProcessorValueTreeState::SliderAttachment(p.apvts, "steps", numStepsKnob));
     numStepsKnob.onValueChange = [this] {
         updateInspector(); // Update slider visibility when step count changes
     };
@@ -143,17 +146,13 @@ StepSequencerAudioProcessorEditor::StepSequencerAudioProcessorEditor (StepSequen
     addAndMakeVisible(rateKnob);
     rateKnob.setSliderStyle(juce::Slider::RotaryVerticalDrag);
     rateKnob.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 50, 20);
-    rateKnob.setRange(0, 3, 1); // 0=1/4, 1=1/8, 2=1/16, 3=1/32
+    rateKnob.setRange(0, SequencerCore::NUM_RATES - 1, 1); // 1/4 .. 1/32, then triplets and dotted
     rateKnob.setMouseDragSensitivity(100);
     rateKnob.textFromValueFunction = [](double value) {
-        int v = (int)value;
-        if (v == 0) return juce::String("1/4");
-        if (v == 1) return juce::String("1/8");
-        if (v == 2) return juce::String("1/16");
-        if (v == 3) return juce::String("1/32");
-        return juce::String("1/16");
+        const auto& names = StepSequencerAudioProcessor::getRateNames();
+        return names[juce::jlimit(0, names.size() - 1, (int)value)];
     };
-    rateAttachment.reset(new juce::AudioProcessorValueTreeState::SliderAttachment(p.apvts, "rate", rateKnob));
+    rateAttachment.reset(new juce::AudioProcessorValueTreeState::SliderAttachment(p.apvts, "stepRate", rateKnob));
 
     // Swing Knob (0-100%)
     addAndMakeVisible(swingLabel);
@@ -261,7 +260,7 @@ StepSequencerAudioProcessorEditor::StepSequencerAudioProcessorEditor (StepSequen
     addAndMakeVisible(clearButton);
     clearButton.setButtonText("Clear");
     clearButton.onClick = [this] {
-        audioProcessor.clearPattern();
+        engine.clearPattern();
         updateInspector();
         repaint();
         // Force DAW to save
@@ -273,7 +272,7 @@ StepSequencerAudioProcessorEditor::StepSequencerAudioProcessorEditor (StepSequen
     addAndMakeVisible(invertButton);
     invertButton.setButtonText("Invert");
     invertButton.onClick = [this] {
-        audioProcessor.invertPattern();
+        engine.invertPattern();
         updateInspector();
         repaint();
         // Force DAW to save
@@ -285,7 +284,7 @@ StepSequencerAudioProcessorEditor::StepSequencerAudioProcessorEditor (StepSequen
     addAndMakeVisible(reverseButton);
     reverseButton.setButtonText("Reverse");
     reverseButton.onClick = [this] {
-        audioProcessor.reversePattern();
+        engine.reversePattern();
         updateInspector();
         repaint();
         // Force DAW to save
@@ -308,13 +307,13 @@ StepSequencerAudioProcessorEditor::StepSequencerAudioProcessorEditor (StepSequen
     euclideanCombo.setSelectedId(1, juce::dontSendNotification);
     euclideanCombo.onChange = [this] {
         int id = euclideanCombo.getSelectedId();
-        int numSteps = (int)*audioProcessor.apvts.getRawParameterValue("numSteps");
+        int numSteps = (int)*audioProcessor.apvts.getRawParameterValue("steps");
         
-        if (id == 2) audioProcessor.euclideanPattern(3, 8);
-        else if (id == 3) audioProcessor.euclideanPattern(5, 8);
-        else if (id == 4) audioProcessor.euclideanPattern(5, 16);
-        else if (id == 5) audioProcessor.euclideanPattern(7, 16);
-        else if (id == 6) audioProcessor.euclideanPattern(9, 16);
+        if (id == 2) engine.euclideanPattern(3, 8);
+        else if (id == 3) engine.euclideanPattern(5, 8);
+        else if (id == 4) engine.euclideanPattern(5, 16);
+        else if (id == 5) engine.euclideanPattern(7, 16);
+        else if (id == 6) engine.euclideanPattern(9, 16);
         
         if (id != 1) {
             updateInspector();
@@ -326,13 +325,146 @@ StepSequencerAudioProcessorEditor::StepSequencerAudioProcessorEditor (StepSequen
         }
     };
 
+    // === SONG / ARRANGEMENT ===
+    addAndMakeVisible(playModeCombo);
+    playModeCombo.addItemList(juce::StringArray { "Chain", "Song", "Layer" }, 1);
+    playModeCombo.setTooltip("Chain: loop enabled tracks in turn. Song: follow the arrangement by host bar. Layer: play all enabled tracks together.");
+    playModeAttachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(p.apvts, "playMode", playModeCombo));
+    playModeCombo.onChange = [this] { repaint(); };
+
+    addAndMakeVisible(songAddButton);
+    songAddButton.setButtonText("+Song");
+    songAddButton.setTooltip("Append the current track to the arrangement (uses its repeat count)");
+    songAddButton.onClick = [this] {
+        int track = engine.currentTrack;
+        engine.appendToArrangement(track, engine.trackRepeat[(size_t)track]);
+        repaint();
+        // Force DAW to save
+        audioProcessor.apvts.getParameter("swing")->setValueNotifyingHost(
+            audioProcessor.apvts.getParameter("swing")->getValue()
+        );
+    };
+
+    addAndMakeVisible(songClearButton);
+    songClearButton.setButtonText("Clear Song");
+    songClearButton.onClick = [this] {
+        engine.clearArrangement();
+        repaint();
+        // Force DAW to save
+        audioProcessor.apvts.getParameter("swing")->setValueNotifyingHost(
+            audioProcessor.apvts.getParameter("swing")->getValue()
+        );
+    };
+
+    // === MIDI INPUT (transpose / key follow from a keyboard) ===
+    addAndMakeVisible(inputModeCombo);
+    inputModeCombo.addItemList(juce::StringArray { "In: Off", "In: Transpose", "In: Key" }, 1);
+    inputModeCombo.setTooltip("Incoming notes transpose the pattern (C4 = as written) or shift it to the played key");
+    inputModeAttachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(p.apvts, "inputMode", inputModeCombo));
+    
+    addAndMakeVisible(inputHoldCombo);
+    inputHoldCombo.addItemList(juce::StringArray { "Latch", "Hold", "Gate" }, 1);
+    inputHoldCombo.setTooltip("Latch: keep the last key. Hold: back to as-written on release. Gate: only play while a key is held.");
+    inputHoldAttachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(p.apvts, "inputHold", inputHoldCombo));
+    
+    addAndMakeVisible(inputApplyCombo);
+    inputApplyCombo.addItemList(juce::StringArray { "Next Step", "Current Note" }, 1);
+    inputApplyCombo.setTooltip("Apply a new transpose from the next note, or retune the sounding note at once");
+    inputApplyAttachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(p.apvts, "inputApply", inputApplyCombo));
+
+    // === STEP RECORDING ===
+    addAndMakeVisible(recordCombo);
+    recordCombo.addItemList(juce::StringArray { "Rec: Off", "Rec: Overdub", "Rec: Replace" }, 1);
+    recordCombo.setTooltip("Record MIDI input into the shown track while playing (quantized to the nearest step)");
+    recordAttachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(p.apvts, "recordMode", recordCombo));
+
+    // === VOICE LIMIT (per channel) ===
+    addAndMakeVisible(voiceLimitSlider);
+    voiceLimitSlider.setSliderStyle(juce::Slider::LinearBar);
+    voiceLimitSlider.setTooltip("Max notes held per MIDI channel");
+    voiceLimitSlider.setTextValueSuffix(" voices");
+    voiceLimitAttachment.reset(new juce::AudioProcessorValueTreeState::SliderAttachment(p.apvts, "voiceLimit", voiceLimitSlider));
+    
+    addAndMakeVisible(voiceStealCombo);
+    voiceStealCombo.addItemList(juce::StringArray { "Oldest", "Quietest" }, 1);
+    voiceStealCombo.setTooltip("Which note gives way when the voice limit is reached");
+    voiceStealAttachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(p.apvts, "voiceSteal", voiceStealCombo));
+    
+    addAndMakeVisible(syncCombo);
+    syncCombo.addItemList(juce::StringArray { "Host", "MIDI Clock" }, 1);
+    syncCombo.setTooltip("Follow the host transport, or MIDI clock and Start / Stop / Continue on the MIDI input");
+    syncAttachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(p.apvts, "syncSource", syncCombo));
+
+    // === AUTOMATION LANES ===
+    addAndMakeVisible(laneLabel);
+    laneLabel.setText("Lanes", juce::dontSendNotification);
+    laneLabel.setJustificationType(juce::Justification::centred);
+    
+    addAndMakeVisible(laneViewCombo);
+    laneViewCombo.addItemList(juce::StringArray { "Probability", "CC", "Pitch Bend", "Pressure" }, 1);
+    laneViewCombo.setSelectedId(1, juce::dontSendNotification);
+    laneViewCombo.setTooltip("What the lower step sliders edit. Lane sliders at the bottom (or double-clicked) send nothing.");
+    laneViewCombo.onChange = [this] {
+        lowerSliderLane = laneViewCombo.getSelectedItemIndex() - 1;
+        configureLowerSliders();
+    };
+    
+    addAndMakeVisible(laneCcSlider);
+    laneCcSlider.setSliderStyle(juce::Slider::LinearBar);
+    laneCcSlider.setTooltip("Controller number the CC lane sends");
+    laneCcSlider.setTextValueSuffix(" CC");
+    laneCcAttachment.reset(new juce::AudioProcessorValueTreeState::SliderAttachment(p.apvts, "laneCc", laneCcSlider));
+    
+    addAndMakeVisible(laneSmoothCombo);
+    laneSmoothCombo.addItemList(StepSequencerAudioProcessor::getLaneResolutionNames(), 1);
+    laneSmoothCombo.setTooltip("Glide lanes towards the next step's value, sending this many values per step");
+    laneSmoothAttachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(p.apvts, "laneSmooth", laneSmoothCombo));
+
+    // === LFOs ===
+    addAndMakeVisible(lfoSelectButton);
+    lfoSelectButton.setTooltip("Switch between the LFOs");
+    lfoSelectButton.onClick = [this] { showLfo((shownLfo + 1) % SequencerCore::NUM_LFOS); };
+    
+    addAndMakeVisible(lfoShapeCombo);
+    lfoShapeCombo.addItemList(juce::StringArray { "Sine", "Triangle", "Saw", "Square", "S&H" }, 1);
+    
+    addAndMakeVisible(lfoRateCombo);
+    lfoRateCombo.addItemList(StepSequencerAudioProcessor::getLfoRateNames(), 1);
+    lfoRateCombo.setTooltip("Cycle length, locked to the song position");
+    
+    addAndMakeVisible(lfoTargetCombo);
+    lfoTargetCombo.addItemList(juce::StringArray { "Off", "Velocity", "Gate", "Probability", "Note (scale)", "Octave" }, 1);
+    lfoTargetCombo.setTooltip("Step value the LFO modulates when each step triggers");
+    
+    addAndMakeVisible(lfoDepthSlider);
+    lfoDepthSlider.setSliderStyle(juce::Slider::LinearBar);
+    lfoDepthSlider.setTextValueSuffix("% depth");
+    
+    showLfo(0);
+
+    // === PERFORMANCE OVERLAY ===
+    addAndMakeVisible(perfButton);
+    perfButton.setButtonText("Perf");
+    perfButton.setClickingTogglesState(true);
+    perfButton.setTooltip("Show CPU load, worst block time and event rate for this instance");
+    perfButton.onClick = [this] { repaint(); };
+    
+    addAndMakeVisible(perfExportButton);
+    perfExportButton.setButtonText("CSV");
+    perfExportButton.setTooltip("Export the recorded per-block timings as CSV");
+    perfExportButton.onClick = [this] { exportPerfCsv(); };
+
     // === TRACK CONTROL BUTTONS ===
+    addAndMakeVisible(tracksLabel);
+    tracksLabel.setJustificationType(juce::Justification::centredLeft);
+    
     addAndMakeVisible(addTrackButton);
     addTrackButton.setButtonText("+");
     addTrackButton.setTooltip("Add Track");
     addTrackButton.onClick = [this] {
-        audioProcessor.addTrack();
+        engine.addTrack();
         rebuildTrackControls();
+        trackList.scrollToEnsureRowIsOnscreen(engine.getNumTracks() - 1);
         updateTracksLabel();
         repaint();
     };
@@ -341,9 +473,10 @@ StepSequencerAudioProcessorEditor::StepSequencerAudioProcessorEditor (StepSequen
     removeTrackButton.setButtonText("-");
     removeTrackButton.setTooltip("Remove Last Track");
     removeTrackButton.onClick = [this] {
-        audioProcessor.removeTrack();
+        engine.removeTrack();
         rebuildTrackControls();
         updateTracksLabel();
+        updateInspector();
         repaint();
     };
 
@@ -352,19 +485,14 @@ StepSequencerAudioProcessorEditor::StepSequencerAudioProcessorEditor (StepSequen
     duplicateTrackButton.setTooltip("Duplicate Current Track");
     duplicateTrackButton.onClick = [this] {
         // Duplicate the current track
-        if (audioProcessor.currentTrack >= 0 && audioProcessor.currentTrack < audioProcessor.getNumTracks()) {
-            auto& currentTrack = audioProcessor.tracks[audioProcessor.currentTrack];
-            
-            // Create a copy of the current track
-            std::vector<StepSequencerAudioProcessor::Step> newTrack = currentTrack;
-            audioProcessor.tracks.push_back(newTrack);
-            audioProcessor.trackRepeat.push_back(audioProcessor.trackRepeat[audioProcessor.currentTrack]);
-            audioProcessor.trackEnabled.push_back(true);
+        if (engine.currentTrack >= 0 && engine.currentTrack < engine.getNumTracks()) {
+            engine.duplicateTrack(engine.currentTrack);
             
             // Switch to the new duplicated track
-            audioProcessor.switchToTrack(audioProcessor.getNumTracks() - 1);
+            engine.switchToTrack(engine.getNumTracks() - 1);
             
             rebuildTrackControls();
+            trackList.scrollToEnsureRowIsOnscreen(engine.getNumTracks() - 1);
             updateTracksLabel();
             updateInspector();
             repaint();
@@ -376,8 +504,32 @@ StepSequencerAudioProcessorEditor::StepSequencerAudioProcessorEditor (StepSequen
         }
     };
 
-    // Initialize track controls
-    rebuildTrackControls();
+    // Track list (rows are created lazily by refreshComponentForRow)
+    addAndMakeVisible(trackList);
+    trackList.setModel(this);
+    trackList.setRowHeight(95);
+    trackList.setColour(juce::ListBox::backgroundColourId, juce::Colour(0x00000000));
+    trackList.setOutlineThickness(0);
+
+    // === PAGE CONTROLS (long patterns are edited one page of MAX_STEP_KNOBS at a time) ===
+    addAndMakeVisible(pagePrevButton);
+    pagePrevButton.setButtonText("<");
+    pagePrevButton.setTooltip("Previous Page");
+    pagePrevButton.onClick = [this] { setPage(currentPage - 1); };
+    
+    addAndMakeVisible(pageNextButton);
+    pageNextButton.setButtonText(">");
+    pageNextButton.setTooltip("Next Page");
+    pageNextButton.onClick = [this] { setPage(currentPage + 1); };
+    
+    addAndMakeVisible(pageLabel);
+    pageLabel.setJustificationType(juce::Justification::centred);
+    
+    addAndMakeVisible(followButton);
+    followButton.setButtonText("Follow");
+    followButton.setTooltip("Page follows the playhead");
+    followButton.setClickingTogglesState(true);
+    followButton.setToggleState(true, juce::dontSendNotification);
 
     // === PER-STEP SLIDERS (Vertical Bars) ===
     
@@ -393,8 +545,9 @@ StepSequencerAudioProcessorEditor::StepSequencerAudioProcessorEditor (StepSequen
         stepVelocityKnobs[i].setColour(juce::Slider::trackColourId, juce::Colours::orange.darker(0.3f));
         stepVelocityKnobs[i].setColour(juce::Slider::thumbColourId, juce::Colours::orange);
         stepVelocityKnobs[i].onValueChange = [this, i] {
-             if (audioProcessor.steps && i < (int)audioProcessor.steps->size()) {
-                (*audioProcessor.steps)[i].velocity = (int)stepVelocityKnobs[i].getValue();
+             if (engine.steps) {
+                const int velocity = (int)stepVelocityKnobs[i].getValue();
+                engine.editStep(getPageStart() + i, [velocity](Step& step) { step.velocity = velocity; });
                 
                 // Force DAW to save
                 audioProcessor.apvts.getParameter("swing")->setValueNotifyingHost(
@@ -416,8 +569,13 @@ StepSequencerAudioProcessorEditor::StepSequencerAudioProcessorEditor (StepSequen
         stepProbabilityKnobs[i].setColour(juce::Slider::trackColourId, juce::Colours::green.darker(0.3f));
         stepProbabilityKnobs[i].setColour(juce::Slider::thumbColourId, juce::Colours::green);
         stepProbabilityKnobs[i].onValueChange = [this, i] {
-            if (audioProcessor.steps && i < (int)audioProcessor.steps->size()) {
-                (*audioProcessor.steps)[i].prob = (float)stepProbabilityKnobs[i].getValue();
+            if (engine.steps) {
+                const double value = stepProbabilityKnobs[i].getValue();
+                const int lane = lowerSliderLane;
+                engine.editStep(getPageStart() + i, [value, lane](Step& step) {
+                    if (lane < 0) step.prob = (float)value;
+                    else step.lanes[(size_t)lane] = (int)value;
+                });
                 
                 // Force DAW to save
                 audioProcessor.apvts.getParameter("swing")->setValueNotifyingHost(
@@ -444,6 +602,14 @@ StepSequencerAudioProcessorEditor::~StepSequencerAudioProcessorEditor()
     swingAttachment.reset();
     keyAttachment.reset();
     scaleAttachment.reset();
+    playModeAttachment.reset();
+    voiceLimitAttachment.reset();
+    voiceStealAttachment.reset();
+    syncAttachment.reset();
+    inputModeAttachment.reset();
+    inputHoldAttachment.reset();
+    inputApplyAttachment.reset();
+    recordAttachment.reset();
 }
 
 bool StepSequencerAudioProcessorEditor::isNoteInScale(int midiNote, int rootNote, int scaleType)
@@ -485,30 +651,27 @@ void StepSequencerAudioProcessorEditor::paint (juce::Graphics& g)
     // Modern Dark Background
     g.fillAll (juce::Colour(0xff121212));
     
-    // Draw Vertical Step Lanes (WRAPPING GRID)
+    // Draw Vertical Step Lanes (WRAPPING GRID, current page only)
+    // Geometry comes from the hit-test layout built in resized()
     if (!stepGridArea.isEmpty()) {
-        int numSteps = (int)*audioProcessor.apvts.getRawParameterValue("numSteps");
-        if (numSteps < 1) numSteps = 16;
-        
-        int stepsPerRow = 16;
-        // Calculate how many rows we need
-        int numRows = (numSteps + stepsPerRow - 1) / stepsPerRow;
-        if (numRows < 1) numRows = 1;
-
-        float laneWidth = stepGridArea.getWidth() / (float)stepsPerRow;
-        float rowHeight = stepGridArea.getHeight() / (float)numRows;
-        float buttonHeight = rowHeight * 0.3f; // Top 30% is button
+        int numCells = (int)stepCells.size();
+        int pageStart = layoutPageStart;
+        int stepsPerRow = layoutStepsPerRow;
+        float laneWidth = layoutLaneWidth;
+        float rowHeight = layoutRowHeight;
         
-        int beatsPerBar = audioProcessor.timeSignatureNumerator;
-        int stepsPerBeat = (beatsPerBar > 0) ? (16 / beatsPerBar) : 4;
+        int beatsPerBar = engine.timeSignatureNumerator;
+        int stepsPerBeat = (beatsPerBar > 0) ? juce::jmax(1, 16 / beatsPerBar) : 4;
         
-        for (int i = 0; i < numSteps && i < MAX_STEP_KNOBS; ++i) {
-            // Calculate grid position
-            int row = i / stepsPerRow;
-            int col = i % stepsPerRow;
+        for (int cell = 0; cell < numCells; ++cell) {
+            // Grid position
+            int i = pageStart + cell; // Absolute step index
+            int row = cell / stepsPerRow;
+            int col = cell % stepsPerRow;
             
-            float x = stepGridArea.getX() + col * laneWidth;
-            float y = stepGridArea.getY() + row * rowHeight;
+            const auto& lane = stepCells[(size_t)cell].lane;
+            float x = lane.getX();
+            float y = lane.getY();
             
             // Draw lane background (alternating for readability)
             bool isBeatStart = (i % stepsPerBeat == 0);
@@ -521,7 +684,7 @@ void StepSequencerAudioProcessorEditor::paint (juce::Graphics& g)
             if (isBeatStart) laneColor = laneColor.brighter(0.05f); // Subtle highlight for beat start
             
             g.setColour(laneColor);
-            g.fillRect(x, y, laneWidth, rowHeight);
+            g.fillRect(lane);
             
             // Draw vertical separator line
             if (col > 0) {
@@ -535,17 +698,16 @@ void StepSequencerAudioProcessorEditor::paint (juce::Graphics& g)
                  g.drawLine(x, y, x + laneWidth, y, 1.0f);
             }
             
-            if (i >= (int)STEPS.size()) continue;
-            
-            bool isActive = STEPS[i].active;
-            bool isPlayhead = (i == audioProcessor.currentStepIndex && audioProcessor.isPlaying);
+            const auto& step = STEP_AT(i);
+            bool isActive = step.active;
+            bool isPlayhead = (i == engine.currentStepIndex && engine.isPlaying);
             bool isSelected = false;
             for (int s : selectedSteps) if (s == i) { isSelected = true; break; }
             
-            float velocity = (float)STEPS[i].velocity / 127.0f;
+            float velocity = (float)step.velocity / 127.0f;
             
             // --- Step Button (Top Section) ---
-            juce::Rectangle<float> buttonRect(x + 4, y + 4, laneWidth - 8, buttonHeight - 8);
+            juce::Rectangle<float> buttonRect = stepCells[(size_t)cell].button;
             
             juce::Colour buttonBaseColor;
             if (isActive) {
@@ -555,6 +717,7 @@ void StepSequencerAudioProcessorEditor::paint (juce::Graphics& g)
                 // Inactive: Dark grey/glassy
                 buttonBaseColor = juce::Colour(0xff333333);
             }
+            if (i == hoveredStep) buttonBaseColor = buttonBaseColor.brighter(0.15f);
             
             // Button fill
             g.setColour(buttonBaseColor);
@@ -569,7 +732,7 @@ void StepSequencerAudioProcessorEditor::paint (juce::Graphics& g)
             // Active glow/highlight
             if (isActive) {
                 g.setColour(juce::Colours::white.withAlpha(0.2f));
-                g.fillRoundedRectangle(buttonRect.removeFromTop(buttonRect.getHeight() * 0.5f), 4.0f);
+                g.fillRoundedRectangle(buttonRect.withHeight(buttonRect.getHeight() * 0.5f), 4.0f);
             }
             
             // Playhead Indicator
@@ -579,35 +742,46 @@ void StepSequencerAudioProcessorEditor::paint (juce::Graphics& g)
                 
                 // Also highlight the whole grid cell slightly
                 g.setColour(juce::Colours::white.withAlpha(0.05f));
-                g.fillRect(x, y, laneWidth, rowHeight);
+                g.fillRect(lane);
             }
             
-            // Note Name Text
+            // Ratchets: one dot per hit along the top edge, spaced by the ratchet curve
+            if (step.ratchets > 1) {
+                auto dots = buttonRect.reduced(6.0f, 0.0f);
+                g.setColour(isActive ? juce::Colours::black.withAlpha(0.7f) : juce::Colours::grey);
+                for (int hit = 0; hit < step.ratchets; ++hit) {
+                    float position = (float)SequencerCore::getRatchetPosition(step.ratchetCurve, hit, step.ratchets);
+                    g.fillEllipse(dots.getX() + position * dots.getWidth() - 1.5f, dots.getY() + 3.0f, 3.0f, 3.0f);
+                }
+            }
+            
+            // Micro-timing: tick from the lane centre towards where the note actually lands
+            if (step.offset != 0.0f) {
+                float centreX = buttonRect.getCentreX();
+                float shiftX = step.offset * laneWidth;
+                float tickY = buttonRect.getBottom() - 3.0f;
+                g.setColour(step.offset < 0.0f ? juce::Colour(0xff66ccff) : juce::Colour(0xffff6666));
+                g.drawLine(centreX, tickY, centreX + shiftX, tickY, 2.0f);
+                g.fillEllipse(centreX + shiftX - 2.5f, tickY - 2.5f, 5.0f, 5.0f);
+            }
+            
+            // Note Name Text (pre-laid-out glyphs, no per-frame String building)
             if (isActive) {
                 g.setColour(juce::Colours::black);
-                g.setFont(12.0f);
-                g.setFont(g.getCurrentFont().boldened());
-                juce::String noteName = juce::MidiMessage::getMidiNoteName(STEPS[i].note, true, true, 3);
-                g.drawText(noteName, buttonRect, juce::Justification::centred);
+                drawCachedLabel(g, noteNameLabels[(size_t)juce::jlimit(0, 127, step.note)], buttonRect, juce::Justification::centred);
             }
         }
         
-        // Draw Beat Numbers
+        // Draw Beat Numbers (counted from the start of the pattern, not the page)
         g.setColour(juce::Colours::white.withAlpha(0.4f));
-        g.setFont(10.0f);
-        for (int beat = 0; beat * stepsPerBeat < numSteps; ++beat) {
-            int i = beat * stepsPerBeat;
-            int row = i / stepsPerRow;
-            int col = i % stepsPerRow;
-            
-            float x = stepGridArea.getX() + (col * laneWidth);
-            float y = stepGridArea.getY() + (row * rowHeight);
-            
-            g.drawText(juce::String(beat + 1), x + 2, y + 2, 20, 10, juce::Justification::left);
+        int firstBeat = (pageStart + stepsPerBeat - 1) / stepsPerBeat;
+        for (int beat = firstBeat; beat * stepsPerBeat < pageStart + numCells; ++beat) {
+            const auto& lane = stepCells[(size_t)(beat * stepsPerBeat - pageStart)].lane;
+            drawCachedLabel(g, getBeatLabel(beat), { lane.getX() + 2, lane.getY() + 2, 20.0f, 10.0f }, juce::Justification::centredLeft);
         }
     }
     
-    // Draw Piano Keyboard Background
+    // Draw Piano Keyboard
     if (!pianoArea.isEmpty()) {
         g.setColour(juce::Colour(0xff000000));
         g.fillRect(pianoArea);
@@ -615,65 +789,31 @@ void StepSequencerAudioProcessorEditor::paint (juce::Graphics& g)
         int rootNote = (int)*audioProcessor.apvts.getRawParameterValue("key");
         int scaleType = (int)*audioProcessor.apvts.getRawParameterValue("scale");
         
-        int startNote = 48; // C3
-        int endNote = 72;   // C5
-        
-        // Count white keys
-        int numWhite = 0;
-        for (int n = startNote; n <= endNote; ++n) {
-            int p = n % 12;
-            if (p==0||p==2||p==4||p==5||p==7||p==9||p==11) numWhite++;
-        }
-        
-        float keyW = (float)pianoArea.getWidth() / (float)numWhite;
-        float h = (float)pianoArea.getHeight();
-        float x = (float)pianoArea.getX();
-        float y = (float)pianoArea.getY();
-        
         int selectedNote = -1;
-        if (!selectedSteps.empty()) selectedNote = STEPS[selectedSteps.back()].note;
+        if (!selectedSteps.empty()) selectedNote = STEP_AT(selectedSteps.back()).note;
         
-        // Draw White Keys
-        int wIdx = 0;
-        for (int n = startNote; n <= endNote; ++n) {
-            int p = n % 12;
-            if (p==0||p==2||p==4||p==5||p==7||p==9||p==11) {
-                bool inScale = isNoteInScale(n, rootNote, scaleType);
-                juce::Rectangle<float> r(x + wIdx * keyW, y, keyW, h);
-                
-                if (n == selectedNote) g.setColour(juce::Colours::red);
+        // Keys are stored white-first, so black keys overlay the white ones
+        for (const auto& key : pianoKeys) {
+            bool inScale = isNoteInScale(key.note, rootNote, scaleType);
+            juce::Rectangle<float> r = key.bounds;
+            
+            if (!key.isBlack) {
+                if (key.note == selectedNote) g.setColour(juce::Colours::red);
                 else if (!inScale) g.setColour(juce::Colour(220, 220, 220)); // Light grey for disabled keys
                 else g.setColour(juce::Colours::white);
+                if (key.note == hoveredNote && key.note != selectedNote) g.setColour(juce::Colour(0xffffe0b0));
                 
                 g.fillRect(r.reduced(1.0f));
                 
-                if (p == 0) {
+                if (key.note % 12 == 0) {
                      g.setColour(juce::Colours::black);
-                     g.setFont(12.0f);
-                     g.drawText("C" + juce::String(n/12 - 1), r.removeFromBottom(20), juce::Justification::centred);
+                     drawCachedLabel(g, pianoOctaveLabels[(size_t)(key.note / 12)], r.removeFromBottom(20), juce::Justification::centred);
                 }
-                
-                wIdx++;
-            }
-        }
-        
-        // Draw Black Keys (Overlay)
-        wIdx = 0;
-        for (int n = startNote; n < endNote; ++n) {
-            int p = n % 12;
-            if (p==0||p==2||p==4||p==5||p==7||p==9||p==11) {
-                wIdx++;
             } else {
-                bool inScale = isNoteInScale(n, rootNote, scaleType);
-                float kw = keyW * 0.6f;
-                float kh = h * 0.6f;
-                float kx = x + (wIdx * keyW) - (kw * 0.5f);
-                
-                juce::Rectangle<float> r(kx, y, kw, kh);
-                
-                if (n == selectedNote) g.setColour(juce::Colours::red);
+                if (key.note == selectedNote) g.setColour(juce::Colours::red);
                 else if (!inScale) g.setColour(juce::Colour(140, 140, 140)); // Medium grey for disabled black keys
                 else g.setColour(juce::Colours::black);
+                if (key.note == hoveredNote && key.note != selectedNote) g.setColour(juce::Colour(0xff664400));
                 
                 g.fillRect(r);
                 g.setColour(juce::Colours::grey);
@@ -681,6 +821,90 @@ void StepSequencerAudioProcessorEditor::paint (juce::Graphics& g)
             }
         }
     }
+    
+    paintSongTimeline(g);
+}
+
+void StepSequencerAudioProcessorEditor::paintOverChildren (juce::Graphics& g)
+{
+    if (perfButton.getToggleState()) paintPerfOverlay(g);
+}
+
+void StepSequencerAudioProcessorEditor::drainTelemetry()
+{
+    // Drained every tick (overlay shown or not) so the FIFO never fills while the editor is open
+    int count;
+    while ((count = audioProcessor.popBlockStats(perfScratch.data(), (int)perfScratch.size())) > 0)
+        perfHistory.insert(perfHistory.end(), perfScratch.begin(), perfScratch.begin() + count);
+    
+    if ((int)perfHistory.size() > MAX_PERF_HISTORY)
+        perfHistory.erase(perfHistory.begin(), perfHistory.begin() + ((int)perfHistory.size() - MAX_PERF_HISTORY / 4 * 3));
+}
+
+void StepSequencerAudioProcessorEditor::paintPerfOverlay(juce::Graphics& g)
+{
+    // Figures over the last second of audio
+    double audioSeconds = 0.0, cpuSeconds = 0.0, worstBlockSeconds = 0.0, peakLoad = 0.0;
+    int events = 0, steps = 0;
+    float onsetError = 0.0f;
+    for (auto it = perfHistory.rbegin(); it != perfHistory.rend() && audioSeconds < 1.0; ++it) {
+        double deadline = it->numSamples / juce::jmax(1.0, it->sampleRate);
+        double elapsed = it->elapsedNs * 1.0e-9;
+        audioSeconds += deadline;
+        cpuSeconds += elapsed;
+        worstBlockSeconds = juce::jmax(worstBlockSeconds, elapsed);
+        if (deadline > 0.0) peakLoad = juce::jmax(peakLoad, elapsed / deadline);
+        events += it->eventsEmitted;
+        steps += it->stepsCrossed;
+        onsetError = juce::jmax(onsetError, it->maxOnsetError);
+    }
+    
+    juce::StringArray lines;
+    if (audioSeconds <= 0.0) {
+        lines.add("No blocks processed yet");
+    } else {
+        lines.add("CPU " + juce::String(100.0 * cpuSeconds / audioSeconds, 2) + "%  (peak block " + juce::String(100.0 * peakLoad, 1) + "%)");
+        lines.add("Worst block " + juce::String(worstBlockSeconds * 1000.0, 3) + " ms");
+        lines.add("Events " + juce::String(events / audioSeconds, 0) + "/s, steps " + juce::String(steps / audioSeconds, 0) + "/s");
+        lines.add("Onset error " + juce::String(onsetError, 2) + " smp max");
+    }
+    
+    auto box = juce::Rectangle<float>(230.0f, 14.0f + 16.0f * lines.size())
+                   .withPosition((float)stepGridArea.getRight() - 236.0f, (float)stepGridArea.getY() + 6.0f);
+    g.setColour(juce::Colours::black.withAlpha(0.75f));
+    g.fillRoundedRectangle(box, 4.0f);
+    g.setColour(juce::Colours::white.withAlpha(0.9f));
+    g.setFont(12.0f);
+    auto text = box.reduced(7.0f);
+    for (const auto& line : lines)
+        g.drawText(line, text.removeFromTop(16.0f), juce::Justification::centredLeft);
+}
+
+void StepSequencerAudioProcessorEditor::exportPerfCsv()
+{
+    perfFileChooser = std::make_unique<juce::FileChooser>("Export Block Timings",
+        juce::File::getSpecialLocation(juce::File::userDocumentsDirectory).getChildFile("step-sequencer-perf.csv"), "*.csv");
+    
+    // Snapshot now - history keeps growing while the dialog is open
+    auto history = perfHistory;
+    perfFileChooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles
+                                     | juce::FileBrowserComponent::warnAboutOverwriting,
+        [history](const juce::FileChooser& chooser) {
+            auto file = chooser.getResult();
+            if (file == juce::File()) return;
+            
+            juce::String csv = "block,elapsed_ns,num_samples,sample_rate,deadline_ns,load_percent,events,steps,max_onset_error_samples\n";
+            for (size_t i = 0; i < history.size(); ++i) {
+                const auto& b = history[i];
+                double deadlineNs = b.numSamples / juce::jmax(1.0, b.sampleRate) * 1.0e9;
+                csv += juce::String((juce::int64)i) + "," + juce::String(b.elapsedNs) + "," + juce::String(b.numSamples) + ","
+                     + juce::String(b.sampleRate, 0) + "," + juce::String(deadlineNs, 0) + ","
+                     + juce::String(deadlineNs > 0.0 ? 100.0 * b.elapsedNs / deadlineNs : 0.0, 3) + ","
+                     + juce::String(b.eventsEmitted) + "," + juce::String(b.stepsCrossed) + ","
+                     + juce::String(b.maxOnsetError, 3) + "\n";
+            }
+            file.replaceWithText(csv);
+        });
 }
 
 void StepSequencerAudioProcessorEditor::resized()
@@ -720,6 +944,27 @@ void StepSequencerAudioProcessorEditor::resized()
     mutateLabel.setBounds(mutateArea.removeFromTop(15));
     mutateKnob.setBounds(mutateArea);
     
+    controlRow.removeFromLeft(20);
+    auto laneArea = controlRow.removeFromLeft(120);
+    laneLabel.setBounds(laneArea.removeFromTop(15));
+    laneViewCombo.setBounds(laneArea.removeFromTop(25));
+    laneArea.removeFromTop(5);
+    laneCcSlider.setBounds(laneArea.removeFromTop(25));
+    laneArea.removeFromTop(5);
+    laneSmoothCombo.setBounds(laneArea.removeFromTop(25));
+    
+    controlRow.removeFromLeft(15);
+    auto lfoArea = controlRow.removeFromLeft(110);
+    lfoSelectButton.setBounds(lfoArea.removeFromTop(20));
+    lfoArea.removeFromTop(4);
+    lfoShapeCombo.setBounds(lfoArea.removeFromTop(22));
+    lfoArea.removeFromTop(2);
+    lfoRateCombo.setBounds(lfoArea.removeFromTop(22));
+    lfoArea.removeFromTop(2);
+    lfoTargetCombo.setBounds(lfoArea.removeFromTop(22));
+    lfoArea.removeFromTop(2);
+    lfoDepthSlider.setBounds(lfoArea.removeFromTop(22));
+    
     // -- Right Group: PITCH (Key, Scale, Octave) --
     // Push to far right?
     // Let's take the remaining width and align right, or just position explicitly.
@@ -748,6 +993,18 @@ void StepSequencerAudioProcessorEditor::resized()
     octaveValueLabel.setBounds(octaveRow.removeFromLeft(40));
     octaveRow.removeFromLeft(5);
     octavePlusButton.setBounds(octaveRow.removeFromLeft(30));
+    octaveRow.removeFromLeft(10);
+    recordCombo.setBounds(octaveRow);
+    
+    pitchArea.removeFromTop(10);
+    
+    // MIDI input (Row 3 of Right Side)
+    auto inputRow = pitchArea.removeFromTop(25);
+    inputModeCombo.setBounds(inputRow.removeFromLeft(100));
+    inputRow.removeFromLeft(5);
+    inputHoldCombo.setBounds(inputRow.removeFromLeft(70));
+    inputRow.removeFromLeft(5);
+    inputApplyCombo.setBounds(inputRow);
 
     area.removeFromTop(10);
     
@@ -766,6 +1023,31 @@ void StepSequencerAudioProcessorEditor::resized()
     euclideanLabel.setBounds(transformRow.removeFromLeft(70));
     transformRow.removeFromLeft(5);
     euclideanCombo.setBounds(transformRow.removeFromLeft(100));
+    transformRow.removeFromLeft(20);
+    
+    playModeCombo.setBounds(transformRow.removeFromLeft(80));
+    transformRow.removeFromLeft(5);
+    songAddButton.setBounds(transformRow.removeFromLeft(60));
+    transformRow.removeFromLeft(5);
+    songClearButton.setBounds(transformRow.removeFromLeft(80));
+    transformRow.removeFromLeft(20);
+    
+    voiceLimitSlider.setBounds(transformRow.removeFromLeft(80));
+    transformRow.removeFromLeft(5);
+    voiceStealCombo.setBounds(transformRow.removeFromLeft(85));
+    transformRow.removeFromLeft(20);
+    syncCombo.setBounds(transformRow.removeFromLeft(90));
+    
+    // Page navigation (right side)
+    perfExportButton.setBounds(transformRow.removeFromRight(40));
+    transformRow.removeFromRight(5);
+    perfButton.setBounds(transformRow.removeFromRight(45));
+    transformRow.removeFromRight(10);
+    followButton.setBounds(transformRow.removeFromRight(60));
+    transformRow.removeFromRight(5);
+    pageNextButton.setBounds(transformRow.removeFromRight(30));
+    pageLabel.setBounds(transformRow.removeFromRight(60));
+    pagePrevButton.setBounds(transformRow.removeFromRight(30));
 
     area.removeFromTop(10);
     
@@ -784,74 +1066,46 @@ void StepSequencerAudioProcessorEditor::resized()
     duplicateTrackButton.setBounds(addRemoveRow.removeFromLeft(60));
     leftSidebar.removeFromTop(10);
     
-    // Show all track buttons with enable toggles and repeat dials (dynamic)
-    int numTracks = audioProcessor.getNumTracks();
-    for (int t = 0; t < numTracks; ++t) {
-        if (t < (int)trackButtons.size()) {
-            auto trackRow = leftSidebar.removeFromTop(40);
-            
-            // Track Select Button (1, 2, 3...)
-            auto buttonArea = trackRow.removeFromLeft(40);
-            trackButtons[t]->setBounds(buttonArea.removeFromTop(30));
-            
-            trackRow.removeFromLeft(5);
-            
-            // Toggle On/Off
-            trackEnableButtons[t]->setBounds(trackRow.removeFromLeft(40).removeFromTop(30));
-            
-            trackRow.removeFromLeft(5);
-            
-            // Repeat Slider
-            if (t < (int)trackRepeatSliders.size()) {
-                trackRepeatSliders[t]->setBounds(trackRow.removeFromLeft(50));
-            }
-            
-            leftSidebar.removeFromTop(5);
-        }
-    }
+    // Track rows (virtualised - the list only lays out what is on screen)
+    trackList.setBounds(leftSidebar);
     
     area.removeFromLeft(8);
     
     // === BOTTOM PIANO ===
     pianoArea = area.removeFromBottom(70);
+    area.removeFromBottom(4);
+    
+    // === SONG TIMELINE (compact strip above the piano) ===
+    songArea = area.removeFromBottom(22);
     area.removeFromBottom(8);
     
     // === VERTICAL STEP LANES (WRAPPING) ===
     stepGridArea = area;
     
-    int numSteps = (int)*audioProcessor.apvts.getRawParameterValue("numSteps");
-    if (numSteps < 1) numSteps = 16;
-    
-    int stepsPerRow = 16;
-    int numRows = (numSteps + stepsPerRow - 1) / stepsPerRow;
-    if (numRows < 1) numRows = 1;
-
-    float laneWidth = stepGridArea.getWidth() / (float)stepsPerRow;
-    float rowHeight = stepGridArea.getHeight() / (float)numRows;
+    updateHitTestLayout();
     
     for (int i = 0; i < MAX_STEP_KNOBS; ++i) {
-        if (i < numSteps && i < (int)STEPS.size()) {
-            int row = i / stepsPerRow;
-            int col = i % stepsPerRow;
+        if (i < (int)stepCells.size()) {
+            const auto& lane = stepCells[(size_t)i].lane;
+            float x = lane.getX();
+            float y = lane.getY();
             
-            float x = stepGridArea.getX() + col * laneWidth;
-            float y = stepGridArea.getY() + row * rowHeight;
+            float buttonHeight = layoutRowHeight * 0.3f;
             
-            float buttonHeight = rowHeight * 0.3f;
+            const auto& step = STEP_AT(layoutPageStart + i);
+            stepVelocityKnobs[i].setValue(step.velocity, juce::dontSendNotification);
+            stepProbabilityKnobs[i].setValue(getLowerSliderValue(step), juce::dontSendNotification);
             
-            stepVelocityKnobs[i].setValue(STEPS[i].velocity, juce::dontSendNotification);
-            stepProbabilityKnobs[i].setValue(STEPS[i].prob, juce::dontSendNotification);
-            
-            float slidersTotalH = rowHeight - buttonHeight - 10;
+            float slidersTotalH = layoutRowHeight - buttonHeight - 10;
             float velHeight = slidersTotalH * 0.5f;
             float probHeight = slidersTotalH * 0.5f;
             
             float velY = y + buttonHeight + 5;
-            stepVelocityKnobs[i].setBounds(x + 1, velY, laneWidth - 2, velHeight);
+            stepVelocityKnobs[i].setBounds(x + 1, velY, layoutLaneWidth - 2, velHeight);
             stepVelocityKnobs[i].setVisible(true);
             
             float probY = velY + velHeight;
-            stepProbabilityKnobs[i].setBounds(x + 1, probY, laneWidth - 2, probHeight);
+            stepProbabilityKnobs[i].setBounds(x + 1, probY, layoutLaneWidth - 2, probHeight);
             stepProbabilityKnobs[i].setVisible(true);
         } else {
             stepVelocityKnobs[i].setVisible(false);
@@ -860,258 +1114,793 @@ void StepSequencerAudioProcessorEditor::resized()
     }
 }
 
-void StepSequencerAudioProcessorEditor::timerCallback() { repaint(); }
-
-void StepSequencerAudioProcessorEditor::mouseDown(const juce::MouseEvent& event)
+void StepSequencerAudioProcessorEditor::updateHitTestLayout()
 {
-    // 1. Piano Interaction
-    if (pianoArea.contains(event.getPosition())) {
-        int startNote = 48; // C3
-        int endNote = 72;   // C5
+    // --- Piano keys ---
+    pianoKeys.clear();
+    pianoNoteByXUpper.assign((size_t)juce::jmax(0, pianoArea.getWidth()), -1);
+    pianoNoteByXLower.assign((size_t)juce::jmax(0, pianoArea.getWidth()), -1);
+    
+    if (!pianoArea.isEmpty()) {
+        auto isWhite = [](int n) { int p = n % 12; return p==0||p==2||p==4||p==5||p==7||p==9||p==11; };
         
         int numWhite = 0;
-        for (int n = startNote; n <= endNote; ++n) {
-            int p = n % 12;
-            if (p==0||p==2||p==4||p==5||p==7||p==9||p==11) numWhite++;
-        }
+        for (int n = PIANO_START_NOTE; n <= PIANO_END_NOTE; ++n)
+            if (isWhite(n)) numWhite++;
         
         float keyW = (float)pianoArea.getWidth() / (float)numWhite;
         float h = (float)pianoArea.getHeight();
         float x = (float)pianoArea.getX();
         float y = (float)pianoArea.getY();
+        pianoBlackKeyHeight = h * 0.6f;
         
-        int clickedNote = -1;
-        
-        // Check Black Keys First
+        // White keys
         int wIdx = 0;
-        for (int n = startNote; n < endNote; ++n) {
-            int p = n % 12;
-            if (p==0||p==2||p==4||p==5||p==7||p==9||p==11) {
+        for (int n = PIANO_START_NOTE; n <= PIANO_END_NOTE; ++n) {
+            if (isWhite(n)) {
+                pianoKeys.push_back({ n, false, { x + wIdx * keyW, y, keyW, h } });
+                wIdx++;
+            }
+        }
+        
+        // Black keys (centred on the boundary between white keys)
+        wIdx = 0;
+        for (int n = PIANO_START_NOTE; n < PIANO_END_NOTE; ++n) {
+            if (isWhite(n)) {
                 wIdx++;
             } else {
                 float kw = keyW * 0.6f;
-                float kh = h * 0.6f;
                 float kx = x + (wIdx * keyW) - (kw * 0.5f);
-                juce::Rectangle<float> r(kx, y, kw, kh);
-                
-                if (r.contains(event.position)) {
-                    clickedNote = n;
-                    break;
-                }
+                pianoKeys.push_back({ n, true, { kx, y, kw, pianoBlackKeyHeight } });
             }
         }
         
-        // Check White Keys
-        if (clickedNote == -1) {
-            wIdx = 0;
-            for (int n = startNote; n <= endNote; ++n) {
-                int p = n % 12;
-                if (p==0||p==2||p==4||p==5||p==7||p==9||p==11) {
-                    float kx = x + (wIdx * keyW);
-                    juce::Rectangle<float> r(kx, y, keyW, h);
-                    
-                    if (r.contains(event.position)) {
-                        clickedNote = n;
-                        break;
-                    }
-                    wIdx++;
-                }
-            }
+        // Per-pixel-column lookup: black keys win in the upper band
+        for (const auto& key : pianoKeys) {
+            auto& table = key.isBlack ? pianoNoteByXUpper : pianoNoteByXLower;
+            int px0 = juce::jmax(0, (int)std::ceil(key.bounds.getX() - x));
+            int px1 = juce::jmin((int)table.size(), (int)std::ceil(key.bounds.getRight() - x));
+            for (int px = px0; px < px1; ++px) table[(size_t)px] = key.note;
         }
+        for (size_t px = 0; px < pianoNoteByXUpper.size(); ++px)
+            if (pianoNoteByXUpper[px] == -1) pianoNoteByXUpper[px] = pianoNoteByXLower[px];
+    }
+    
+    // --- Step grid (one page of up to MAX_STEP_KNOBS steps) ---
+    int numSteps = getDisplayedLength();
+    
+    layoutNumSteps = numSteps;
+    currentPage = juce::jlimit(0, getNumPages() - 1, currentPage);
+    layoutPageStart = getPageStart();
+    int numCells = juce::jmin(numSteps - layoutPageStart, (int)MAX_STEP_KNOBS);
+    
+    pageLabel.setText(juce::String(currentPage + 1) + "/" + juce::String(getNumPages()), juce::dontSendNotification);
+    pagePrevButton.setEnabled(currentPage > 0);
+    pageNextButton.setEnabled(currentPage < getNumPages() - 1);
+    
+    int stepsPerRow = 16;
+    int numRows = (numCells + stepsPerRow - 1) / stepsPerRow;
+    if (numRows < 1) numRows = 1;
+    
+    layoutStepsPerRow = stepsPerRow;
+    layoutLaneWidth = stepGridArea.getWidth() / (float)stepsPerRow;
+    layoutRowHeight = stepGridArea.getHeight() / (float)numRows;
+    float buttonHeight = layoutRowHeight * 0.3f; // Top 30% is button
+    
+    stepCells.clear();
+    if (stepGridArea.isEmpty()) return;
+    
+    for (int i = 0; i < numCells; ++i) {
+        int row = i / stepsPerRow;
+        int col = i % stepsPerRow;
+        float x = stepGridArea.getX() + col * layoutLaneWidth;
+        float y = stepGridArea.getY() + row * layoutRowHeight;
         
+        StepCell cell;
+        cell.lane = { x, y, layoutLaneWidth, layoutRowHeight };
+        cell.button = { x + 4, y + 4, layoutLaneWidth - 8, buttonHeight - 8 };
+        stepCells.push_back(cell);
+    }
+    
+    updateLabelCache();
+}
+
+void StepSequencerAudioProcessorEditor::updateLabelCache()
+{
+    // Note names shrink with narrow lanes; everything else is fixed size.
+    // Glyphs are only re-laid-out when a font size actually changes.
+    float noteHeight = juce::jlimit(7.0f, 12.0f, layoutLaneWidth * 0.3f);
+    
+    if (noteHeight != noteLabelFontHeight) {
+        noteLabelFontHeight = noteHeight;
+        juce::Font font = juce::Font(noteHeight).boldened();
+        for (int n = 0; n < 128; ++n)
+            makeCachedLabel(noteNameLabels[(size_t)n], font, juce::MidiMessage::getMidiNoteName(n, true, true, 3));
+    }
+    
+    if (pianoLabelFontHeight != 12.0f) {
+        pianoLabelFontHeight = 12.0f;
+        juce::Font font(pianoLabelFontHeight);
+        for (int octave = 0; octave < (int)pianoOctaveLabels.size(); ++octave)
+            makeCachedLabel(pianoOctaveLabels[(size_t)octave], font, "C" + juce::String(octave - 1));
+    }
+    
+    if (beatLabelFontHeight != 10.0f) {
+        beatLabelFontHeight = 10.0f;
+        beatNumberLabels.clear();
+        beatNumberLabels.reserve(MAX_STEP_KNOBS);
+    }
+}
+
+const StepSequencerAudioProcessorEditor::CachedLabel& StepSequencerAudioProcessorEditor::getBeatLabel(int beatIndex)
+{
+    // Grown on demand; steady-state frames hit existing entries only
+    while ((int)beatNumberLabels.size() <= beatIndex) {
+        beatNumberLabels.emplace_back();
+        makeCachedLabel(beatNumberLabels.back(), juce::Font(beatLabelFontHeight), juce::String((int)beatNumberLabels.size()));
+    }
+    return beatNumberLabels[(size_t)beatIndex];
+}
+
+const StepSequencerAudioProcessorEditor::CachedLabel& StepSequencerAudioProcessorEditor::getSongEntryLabel(int entryIndex)
+{
+    // Re-laid-out only when the entry's track, repeats or transpose change
+    const auto& entry = engine.arrangement[(size_t)entryIndex];
+    if ((int)songEntryLabels.size() <= entryIndex) songEntryLabels.resize((size_t)entryIndex + 1);
+    auto& cached = songEntryLabels[(size_t)entryIndex];
+    if (cached.pattern != entry.pattern || cached.repeats != entry.repeats || cached.transpose != entry.transpose) {
+        cached.pattern = entry.pattern;
+        cached.repeats = entry.repeats;
+        cached.transpose = entry.transpose;
+        juce::String text = "T" + juce::String(entry.pattern + 1) + " x" + juce::String(entry.repeats);
+        if (entry.transpose != 0) text += (entry.transpose > 0 ? " +" : " ") + juce::String(entry.transpose);
+        makeCachedLabel(cached.label, juce::Font(11.0f), text);
+    }
+    return cached.label;
+}
+
+void StepSequencerAudioProcessorEditor::makeCachedLabel(CachedLabel& label, const juce::Font& font, const juce::String& text)
+{
+    label.glyphs.clear();
+    label.glyphs.addLineOfText(font, text, 0.0f, 0.0f);
+    label.bounds = label.glyphs.getBoundingBox(0, -1, true);
+}
+
+void StepSequencerAudioProcessorEditor::drawCachedLabel(juce::Graphics& g, const CachedLabel& label,
+                                                        juce::Rectangle<float> area, juce::Justification justification)
+{
+    // Glyphs were laid out with their baseline at y = 0; shift the cached bounds into place
+    float dx = area.getCentreX() - label.bounds.getCentreX();
+    if (justification.testFlags(juce::Justification::left)) dx = area.getX() - label.bounds.getX();
+    else if (justification.testFlags(juce::Justification::right)) dx = area.getRight() - label.bounds.getRight();
+    
+    float dy = area.getCentreY() - label.bounds.getCentreY();
+    label.glyphs.draw(g, juce::AffineTransform::translation(dx, dy));
+}
+
+int StepSequencerAudioProcessorEditor::getNoteAt(juce::Point<int> pos) const
+{
+    if (!pianoArea.contains(pos)) return -1;
+    
+    size_t px = (size_t)(pos.x - pianoArea.getX());
+    const auto& table = ((float)(pos.y - pianoArea.getY()) < pianoBlackKeyHeight) ? pianoNoteByXUpper : pianoNoteByXLower;
+    return px < table.size() ? table[px] : -1;
+}
+
+int StepSequencerAudioProcessorEditor::getStepButtonAt(juce::Point<int> pos) const
+{
+    if (!stepGridArea.contains(pos) || layoutLaneWidth <= 0.0f || layoutRowHeight <= 0.0f) return -1;
+    
+    float relativeX = (float)(pos.x - stepGridArea.getX());
+    float relativeY = (float)(pos.y - stepGridArea.getY());
+    
+    int col = (int)(relativeX / layoutLaneWidth);
+    int row = (int)(relativeY / layoutRowHeight);
+    int laneIndex = row * layoutStepsPerRow + col;
+    
+    // Only the button area (top 30% of each row) counts
+    float rowRelativeY = relativeY - (row * layoutRowHeight);
+    if (rowRelativeY >= layoutRowHeight * 0.3f) return -1;
+    
+    if (laneIndex < 0 || laneIndex >= (int)stepCells.size()) return -1;
+    return layoutPageStart + laneIndex;
+}
+
+void StepSequencerAudioProcessorEditor::timerCallback()
+{
+    // Step count may be automated by the host - keep the hit-test layout in sync
+    // (the current track may follow the global "steps" or have its own length)
+    int numSteps = getDisplayedLength();
+    if (numSteps != layoutNumSteps) updateInspector();
+    
+    // Page follows the playhead through long patterns
+    if (followButton.getToggleState() && engine.isPlaying) {
+        int playheadPage = engine.currentStepIndex / MAX_STEP_KNOBS;
+        if (playheadPage != currentPage) setPage(playheadPage);
+    }
+    
+    // Steps recorded from MIDI input - re-sync the per-step sliders
+    int editCount = engine.recordedEditCount.load();
+    if (editCount != lastRecordedEditCount) {
+        lastRecordedEditCount = editCount;
+        updateInspector();
+    }
+    
+    // Recorded edits the queue had no room for - flagged on the record selector
+    int dropped = engine.droppedRecordEdits.load();
+    if (dropped != lastDroppedRecordEdits) {
+        lastDroppedRecordEdits = dropped;
+        recordCombo.setColour(juce::ComboBox::outlineColourId, juce::Colours::red);
+        recordCombo.setTooltip(juce::String(dropped) + " recorded edits were lost while the message thread was busy - check the recorded steps");
+    }
+    
+    drainTelemetry();
+    
+    // Follow track changes made by playback
+    if (engine.currentTrack != displayedTrack) {
+        rebuildTrackControls();
+        updateInspector();
+    }
+    
+    repaint();
+}
+
+void StepSequencerAudioProcessorEditor::mouseDown(const juce::MouseEvent& event)
+{
+    dragMode = DragMode::None;
+    
+    // 1. Piano Interaction
+    if (pianoArea.contains(event.getPosition())) {
+        int clickedNote = getNoteAt(event.getPosition());
         if (clickedNote != -1) {
-            // Apply to selected steps
-            if (!selectedSteps.empty()) {
-                for (int idx : selectedSteps) {
-                    if (idx >= 0 && idx < (int)STEPS.size()) {
-                        STEPS[idx].note = clickedNote;
-                        STEPS[idx].active = true;
-                    }
-                }
-                
-                // Force DAW to save
-                audioProcessor.apvts.getParameter("swing")->setValueNotifyingHost(
-                    audioProcessor.apvts.getParameter("swing")->getValue()
-                );
-            }
-            updateInspector();
-            repaint();
+            dragMode = DragMode::PaintNotes;
+            hoveredNote = clickedNote;
+            applyNoteToSelection(clickedNote);
         }
         return;
     }
 
     // 2. Step Lane Interaction
-    if (stepGridArea.contains(event.getPosition())) {
-        int numSteps = (int)*audioProcessor.apvts.getRawParameterValue("numSteps");
-        if (numSteps < 1) numSteps = 16;
-        
-        int stepsPerRow = 16;
-        int numRows = (numSteps + stepsPerRow - 1) / stepsPerRow;
-        if (numRows < 1) numRows = 1;
+    int laneIndex = getStepButtonAt(event.getPosition());
+    if (laneIndex != -1 && event.mods.isAltDown()) {
+        // Alt-drag sideways: micro-timing offset (early / late)
+        dragMode = DragMode::NudgeTiming;
+        nudgeStep = laneIndex;
+        nudgeStartOffset = STEP_AT(laneIndex).offset;
+        return;
+    }
+    if (laneIndex != -1) {
+        dragMode = DragMode::SelectSteps;
+        selectStep(laneIndex, event.mods.isShiftDown());
+    }
+}
 
-        float laneWidth = stepGridArea.getWidth() / (float)stepsPerRow;
-        float rowHeight = stepGridArea.getHeight() / (float)numRows;
-        
-        float relativeX = event.getPosition().x - stepGridArea.getX();
-        float relativeY = event.getPosition().y - stepGridArea.getY();
-        
-        int col = (int)(relativeX / laneWidth);
-        int row = (int)(relativeY / rowHeight);
-        
-        int laneIndex = row * stepsPerRow + col;
-        float buttonHeight = rowHeight * 0.3f;
-        float rowRelativeY = relativeY - (row * rowHeight);
+void StepSequencerAudioProcessorEditor::mouseDrag(const juce::MouseEvent& event)
+{
+    if (dragMode == DragMode::PaintNotes) {
+        // Drag across the keyboard to audition/paint notes onto the selection
+        int note = getNoteAt(event.getPosition());
+        if (note != -1 && note != hoveredNote) {
+            hoveredNote = note;
+            applyNoteToSelection(note);
+        }
+    }
+    else if (dragMode == DragMode::NudgeTiming) {
+        // A full lane width of drag covers the whole early..late range
+        float range = 2.0f * SequencerCore::MAX_STEP_OFFSET;
+        float offset = nudgeStartOffset + range * (float)event.getDistanceFromDragStartX() / juce::jmax(1.0f, layoutLaneWidth);
+        if (event.mods.isShiftDown()) offset = std::round(offset * 20.0f) / 20.0f; // Snap to 5%
+        offset = juce::jlimit(-SequencerCore::MAX_STEP_OFFSET, SequencerCore::MAX_STEP_OFFSET, offset);
         
-        // Only respond if clicking in the button area (top 30%)
-        if (laneIndex >= 0 && laneIndex < numSteps && laneIndex < (int)STEPS.size() && rowRelativeY < buttonHeight) {
-            // Selection Logic
-            if (!event.mods.isShiftDown()) selectedSteps.clear();
-            
-            // Add to selection if not present
-            bool alreadySelected = false;
-            for (int s : selectedSteps) if (s == laneIndex) alreadySelected = true;
-            if (!alreadySelected) selectedSteps.push_back(laneIndex);
-            
-            // Activation Logic:
-            // Single click activates if inactive.
-            // Does NOT toggle off active steps (that requires double click).
-            if (!STEPS[laneIndex].active) {
-                STEPS[laneIndex].active = true;
-            }
-            
-            // Force DAW to save by actually changing a parameter
-            audioProcessor.apvts.getParameter("swing")->setValueNotifyingHost(
-                audioProcessor.apvts.getParameter("swing")->getValue()
-            );
-            
-            updateInspector();
+        if (offset != STEP_AT(nudgeStep).offset) {
+            engine.editStep(nudgeStep, [offset](Step& step) { step.offset = offset; });
             repaint();
         }
     }
+    else if (dragMode == DragMode::SelectSteps) {
+        // Drag across step buttons to extend the selection
+        int laneIndex = getStepButtonAt(event.getPosition());
+        if (laneIndex != -1 && laneIndex != hoveredStep) {
+            hoveredStep = laneIndex;
+            selectStep(laneIndex, true);
+        }
+    }
+}
+
+void StepSequencerAudioProcessorEditor::mouseUp(const juce::MouseEvent& event)
+{
+    juce::ignoreUnused(event);
+    if (dragMode == DragMode::NudgeTiming) forceSave();
+    dragMode = DragMode::None;
+}
+
+void StepSequencerAudioProcessorEditor::mouseMove(const juce::MouseEvent& event)
+{
+    int step = getStepButtonAt(event.getPosition());
+    int note = getNoteAt(event.getPosition());
+    
+    if (step != hoveredStep || note != hoveredNote) {
+        hoveredStep = step;
+        hoveredNote = note;
+        repaint();
+    }
+}
+
+void StepSequencerAudioProcessorEditor::mouseExit(const juce::MouseEvent& event)
+{
+    juce::ignoreUnused(event);
+    if (hoveredStep != -1 || hoveredNote != -1) {
+        hoveredStep = -1;
+        hoveredNote = -1;
+        repaint();
+    }
+}
+
+void StepSequencerAudioProcessorEditor::applyNoteToSelection(int note)
+{
+    // Apply to selected steps
+    if (!selectedSteps.empty()) {
+        for (int idx : selectedSteps) {
+            if (idx >= 0 && idx < SequencerCore::MAX_STEPS) {
+                engine.editStep(idx, [note](Step& step) {
+                    step.note = note;
+                    step.active = true;
+                });
+            }
+        }
+        
+        // Force DAW to save
+        audioProcessor.apvts.getParameter("swing")->setValueNotifyingHost(
+            audioProcessor.apvts.getParameter("swing")->getValue()
+        );
+    }
+    // Note changes don't affect the per-step sliders, so no re-layout needed while dragging
+    repaint();
+}
+
+void StepSequencerAudioProcessorEditor::selectStep(int stepIndex, bool addToSelection)
+{
+    // Selection Logic
+    if (!addToSelection) selectedSteps.clear();
+    
+    // Add to selection if not present
+    bool alreadySelected = false;
+    for (int s : selectedSteps) if (s == stepIndex) alreadySelected = true;
+    if (!alreadySelected) selectedSteps.push_back(stepIndex);
+    
+    // Activation Logic:
+    // Single click activates if inactive.
+    // Does NOT toggle off active steps (that requires double click).
+    if (!STEP_AT(stepIndex).active) {
+        engine.editStep(stepIndex, [](Step& step) { step.active = true; });
+    }
+    
+    // Force DAW to save by actually changing a parameter
+    audioProcessor.apvts.getParameter("swing")->setValueNotifyingHost(
+        audioProcessor.apvts.getParameter("swing")->getValue()
+    );
+    
+    repaint();
 }
 
 void StepSequencerAudioProcessorEditor::mouseDoubleClick(const juce::MouseEvent& event)
 {
+    // Alt + double-click a step: reset its micro-timing
+    if (event.mods.isAltDown()) {
+        int stepIndex = getStepButtonAt(event.getPosition());
+        if (stepIndex != -1) {
+            if (STEP_AT(stepIndex).offset != 0.0f) engine.editStep(stepIndex, [](Step& step) { step.offset = 0.0f; });
+            forceSave();
+            repaint();
+        }
+        return;
+    }
+    
+    // Double-click a song entry to remove it (later entries close the gap)
+    int entryIndex = getSongEntryAt(event.getPosition());
+    if (entryIndex != -1) {
+        engine.removeArrangementEntry(entryIndex);
+        
+        // Force DAW to save
+        audioProcessor.apvts.getParameter("swing")->setValueNotifyingHost(
+            audioProcessor.apvts.getParameter("swing")->getValue()
+        );
+        repaint();
+        return;
+    }
+    
     // Double-click to clear a step
-    if (stepGridArea.contains(event.getPosition())) {
-        int numSteps = (int)*audioProcessor.apvts.getRawParameterValue("numSteps");
-        if (numSteps < 1) numSteps = 16;
+    int laneIndex = getStepButtonAt(event.getPosition());
+    if (laneIndex != -1) {
+        if (STEP_AT(laneIndex).active) engine.editStep(laneIndex, [](Step& step) { step.active = false; });
         
-        int stepsPerRow = 16;
-        int numRows = (numSteps + stepsPerRow - 1) / stepsPerRow;
-        if (numRows < 1) numRows = 1;
-
-        float laneWidth = stepGridArea.getWidth() / (float)stepsPerRow;
-        float rowHeight = stepGridArea.getHeight() / (float)numRows;
+        // Force DAW to save
+        audioProcessor.apvts.getParameter("swing")->setValueNotifyingHost(
+            audioProcessor.apvts.getParameter("swing")->getValue()
+        );
         
-        float relativeX = event.getPosition().x - stepGridArea.getX();
-        float relativeY = event.getPosition().y - stepGridArea.getY();
+        updateInspector();
+        repaint();
+    }
+}
+
+void StepSequencerAudioProcessorEditor::mouseWheelMove(const juce::MouseEvent& event, const juce::MouseWheelDetails& wheel)
+{
+    int delta = wheel.deltaY > 0 ? 1 : (wheel.deltaY < 0 ? -1 : 0);
+    
+    // Wheel over a step button: ratchet count (shift = ratchet curve)
+    int stepIndex = getStepButtonAt(event.getPosition());
+    if (stepIndex != -1) {
+        if (delta == 0) return;
+        const bool curve = event.mods.isShiftDown();
+        engine.editStep(stepIndex, [curve, delta](Step& step) {
+            if (curve) step.ratchetCurve = (step.ratchetCurve + delta + SequencerCore::NUM_RATCHET_CURVES) % SequencerCore::NUM_RATCHET_CURVES;
+            else step.ratchets = juce::jlimit(1, SequencerCore::MAX_RATCHETS, step.ratchets + delta);
+        });
+        forceSave();
+        repaint();
+        return;
+    }
+    
+    // Wheel over a song entry: transpose (shift = repeat count)
+    int entryIndex = getSongEntryAt(event.getPosition());
+    if (entryIndex == -1) {
+        juce::AudioProcessorEditor::mouseWheelMove(event, wheel);
+        return;
+    }
+    
+    if (delta == 0) return;
+    
+    const auto& entry = engine.arrangement[(size_t)entryIndex];
+    if (event.mods.isShiftDown()) engine.setArrangementRepeats(entryIndex, entry.repeats + delta);
+    else engine.setArrangementTranspose(entryIndex, entry.transpose + delta);
+    
+    // Force DAW to save
+    audioProcessor.apvts.getParameter("swing")->setValueNotifyingHost(
+        audioProcessor.apvts.getParameter("swing")->getValue()
+    );
+    repaint();
+}
+
+float StepSequencerAudioProcessorEditor::getSongBarWidth() const
+{
+    // Fit the whole song (plus a bar of headroom) into the strip, capped so short songs stay readable
+    const auto& arrangement = engine.arrangement;
+    int totalBars = arrangement.empty() ? 1
+                  : arrangement.back().startBar + engine.getEntryLengthInBars(arrangement.back()) + 1;
+    return juce::jmin(40.0f, (float)songArea.getWidth() / (float)juce::jmax(1, totalBars));
+}
+
+int StepSequencerAudioProcessorEditor::getSongEntryAt(juce::Point<int> pos) const
+{
+    if (!songArea.contains(pos)) return -1;
+    
+    int bar = (int)((pos.x - songArea.getX()) / getSongBarWidth());
+    int entryIndex = engine.findArrangementEntry(bar);
+    if (entryIndex < 0) return -1;
+    
+    // Only inside the entry's own span, not the gap after it
+    const auto& entry = engine.arrangement[(size_t)entryIndex];
+    return bar < entry.startBar + engine.getEntryLengthInBars(entry) ? entryIndex : -1;
+}
+
+void StepSequencerAudioProcessorEditor::paintSongTimeline(juce::Graphics& g)
+{
+    if (songArea.isEmpty()) return;
+    
+    auto strip = songArea.toFloat();
+    g.setColour(juce::Colour(0xff1e1e1e));
+    g.fillRoundedRectangle(strip, 3.0f);
+    
+    const auto& arrangement = engine.arrangement;
+    bool songMode = (int)*audioProcessor.apvts.getRawParameterValue("playMode") == 1;
+    
+    if (arrangement.empty()) {
+        g.setColour(juce::Colours::grey);
+        g.setFont(12.0f);
+        g.drawText("Song empty - use +Song to append the current track", songArea.reduced(6, 0), juce::Justification::centredLeft);
+        return;
+    }
+    
+    float barWidth = getSongBarWidth();
+    
+    for (int e = 0; e < (int)arrangement.size(); ++e) {
+        const auto& entry = arrangement[(size_t)e];
+        float x = strip.getX() + entry.startBar * barWidth;
+        if (x >= strip.getRight()) break;
         
-        int col = (int)(relativeX / laneWidth);
-        int row = (int)(relativeY / rowHeight);
+        float w = engine.getEntryLengthInBars(entry) * barWidth;
+        auto r = juce::Rectangle<float>(x, strip.getY(), w, strip.getHeight()).reduced(1.0f, 2.0f);
         
-        int laneIndex = row * stepsPerRow + col;
-        float buttonHeight = rowHeight * 0.3f;
-        float rowRelativeY = relativeY - (row * rowHeight);
+        bool isCurrent = songMode && engine.isPlaying && e == engine.currentArrangementEntry;
+        g.setColour(isCurrent ? juce::Colour(0xffffaa00) : juce::Colour(0xff3a3a3a));
+        g.fillRoundedRectangle(r, 2.0f);
         
-        if (laneIndex >= 0 && laneIndex < numSteps && laneIndex < (int)STEPS.size() && rowRelativeY < buttonHeight) {
-            STEPS[laneIndex].active = false;
-            
-            // Force DAW to save
-            audioProcessor.apvts.getParameter("swing")->setValueNotifyingHost(
-                audioProcessor.apvts.getParameter("swing")->getValue()
-            );
-            
-            updateInspector();
-            repaint();
+        g.setColour(isCurrent ? juce::Colours::black : juce::Colours::white);
+        const juce::Graphics::ScopedSaveState clip (g);
+        g.reduceClipRegion(r.reduced(3.0f, 0.0f).toNearestInt());
+        drawCachedLabel(g, getSongEntryLabel(e), r.reduced(3.0f, 0.0f), juce::Justification::centredLeft);
+    }
+    
+    // Playhead bar
+    if (songMode && engine.isPlaying) {
+        float x = strip.getX() + engine.currentSongBar * barWidth;
+        if (x < strip.getRight()) {
+            g.setColour(juce::Colours::white);
+            g.drawLine(x, strip.getY(), x, strip.getBottom(), 2.0f);
         }
     }
 }
 
+void StepSequencerAudioProcessorEditor::forceSave()
+{
+    // Force DAW to save by re-sending a parameter's current value
+    audioProcessor.apvts.getParameter("swing")->setValueNotifyingHost(
+        audioProcessor.apvts.getParameter("swing")->getValue()
+    );
+}
+
+void StepSequencerAudioProcessorEditor::setPage(int page)
+{
+    page = juce::jlimit(0, getNumPages() - 1, page);
+    if (page == currentPage) return;
+    
+    currentPage = page;
+    updateInspector(); // Re-lay out the grid and re-bind the sliders to the new page
+    repaint();
+}
+
+int StepSequencerAudioProcessorEditor::getNumPages() const
+{
+    int numSteps = getDisplayedLength();
+    return (numSteps + MAX_STEP_KNOBS - 1) / MAX_STEP_KNOBS;
+}
+
+int StepSequencerAudioProcessorEditor::getDisplayedLength() const
+{
+    return engine.getTrackLength(engine.currentTrack);
+}
+
 void StepSequencerAudioProcessorEditor::updateTracksLabel()
 {
-    int enabledCount = 0;
-    for (size_t i = 0; i < audioProcessor.trackEnabled.size(); ++i) {
-        if (audioProcessor.trackEnabled[i]) enabledCount++;
-    }
-    tracksLabel.setText("Tracks: " + juce::String(enabledCount) + "/" + juce::String(audioProcessor.getNumTracks()), juce::dontSendNotification);
+    tracksLabel.setText("Tracks: " + juce::String(engine.getNumEnabledTracks()) + "/" + juce::String(engine.getNumTracks()), juce::dontSendNotification);
 }
 
 void StepSequencerAudioProcessorEditor::rebuildTrackControls()
 {
-    // Clear existing controls
-    trackButtons.clear();
-    trackEnableButtons.clear();
-    trackRepeatSliders.clear();
-    
-    int numTracks = audioProcessor.getNumTracks();
-    
-    for (int t = 0; t < numTracks; ++t) {
-        // Track select button
-        auto trackBtn = std::make_unique<juce::TextButton>();
-        trackBtn->setButtonText(juce::String(t + 1));
-        trackBtn->setClickingTogglesState(true);
-        trackBtn->setRadioGroupId(1001);
-        trackBtn->onClick = [this, t] {
-            audioProcessor.switchToTrack(t);
-            updateInspector(); // Sync UI with new track's data
-            updateTracksLabel();
-            repaint();
-        };
-        addAndMakeVisible(trackBtn.get());
-        if (t == audioProcessor.currentTrack) trackBtn->setToggleState(true, juce::dontSendNotification);
-        trackButtons.push_back(std::move(trackBtn));
-        
-        // Track enable toggle button
-        auto enableBtn = std::make_unique<juce::TextButton>();
-        enableBtn->setButtonText("On");
-        enableBtn->setClickingTogglesState(true);
-        enableBtn->setToggleState(audioProcessor.trackEnabled[t], juce::dontSendNotification);
-        auto* enableBtnPtr = enableBtn.get();
-        enableBtn->onClick = [this, t, enableBtnPtr] {
-            audioProcessor.trackEnabled[t] = enableBtnPtr->getToggleState();
-            updateTracksLabel();
-            repaint();
-        };
-        addAndMakeVisible(enableBtn.get());
-        trackEnableButtons.push_back(std::move(enableBtn));
-        
-        // Track repeat slider
-        auto repeatSlider = std::make_unique<juce::Slider>();
-        repeatSlider->setSliderStyle(juce::Slider::RotaryVerticalDrag);
-        repeatSlider->setTextBoxStyle(juce::Slider::TextBoxBelow, false, 30, 15);
-        repeatSlider->setRange(1.0, 16.0, 1.0);
-        if (t < (int)audioProcessor.trackRepeat.size()) {
-            repeatSlider->setValue(audioProcessor.trackRepeat[t]);
-        }
-        repeatSlider->setMouseDragSensitivity(100);
-        auto* repeatSliderPtr = repeatSlider.get();
-        repeatSlider->onValueChange = [this, t, repeatSliderPtr] {
-            if (t < (int)audioProcessor.trackRepeat.size()) {
-                audioProcessor.trackRepeat[t] = (int)repeatSliderPtr->getValue();
-            }
-        };
-        addAndMakeVisible(repeatSlider.get());
-        trackRepeatSliders.push_back(std::move(repeatSlider));
+    // Only the visible rows are refreshed; off-screen tracks have no components
+    trackList.updateContent();
+    displayedTrack = engine.currentTrack;
+}
+
+void StepSequencerAudioProcessorEditor::trackSelected(int trackIndex)
+{
+    engine.switchToTrack(trackIndex);
+    rebuildTrackControls(); // Move the highlight
+    updateInspector();      // Sync UI with new track's data
+    updateTracksLabel();
+    repaint();
+}
+
+//==============================================================================
+int StepSequencerAudioProcessorEditor::getNumRows()
+{
+    return engine.getNumTracks();
+}
+
+void StepSequencerAudioProcessorEditor::paintListBoxItem(int rowNumber, juce::Graphics& g, int width, int height, bool rowIsSelected)
+{
+    // Rows draw themselves via TrackRow components
+    juce::ignoreUnused(rowNumber, g, width, height, rowIsSelected);
+}
+
+juce::Component* StepSequencerAudioProcessorEditor::refreshComponentForRow(int rowNumber, bool isRowSelected, juce::Component* existingComponentToUpdate)
+{
+    juce::ignoreUnused(isRowSelected);
+    auto* row = static_cast<TrackRow*>(existingComponentToUpdate);
+    
+    if (rowNumber >= engine.getNumTracks()) {
+        delete row;
+        return nullptr;
     }
+    
+    // Recycle the row the list hands back; only create one when scrolling reveals a new slot
+    if (row == nullptr) row = new TrackRow(*this);
+    row->update(rowNumber);
+    return row;
+}
+
+//==============================================================================
+StepSequencerAudioProcessorEditor::TrackRow::TrackRow(StepSequencerAudioProcessorEditor& o)
+    : owner(o)
+{
+    // Track select button (1, 2, 3...)
+    addAndMakeVisible(selectButton);
+    selectButton.onClick = [this] {
+        if (trackIndex >= 0) owner.trackSelected(trackIndex);
+    };
+    
+    // Track enable toggle button
+    addAndMakeVisible(enableButton);
+    enableButton.setButtonText("On");
+    enableButton.setClickingTogglesState(true);
+    enableButton.onClick = [this] {
+        owner.engine.setTrackEnabled(trackIndex, enableButton.getToggleState());
+        owner.updateTracksLabel();
+        owner.repaint();
+    };
+    
+    // Track repeat slider
+    addAndMakeVisible(repeatSlider);
+    repeatSlider.setSliderStyle(juce::Slider::RotaryVerticalDrag);
+    repeatSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 30, 15);
+    repeatSlider.setRange(1.0, 16.0, 1.0);
+    repeatSlider.setMouseDragSensitivity(100);
+    repeatSlider.onValueChange = [this] {
+        if (trackIndex >= 0) owner.engine.setTrackRepeat(trackIndex, (int)repeatSlider.getValue());
+    };
+    
+    // Per-track rate ("Global" follows the Rate knob)
+    addAndMakeVisible(rateCombo);
+    rateCombo.addItem("Global", 1);
+    rateCombo.addItemList(StepSequencerAudioProcessor::getRateNames(), 2);
+    rateCombo.setTooltip("Track Rate");
+    rateCombo.onChange = [this] {
+        if (trackIndex < 0) return;
+        owner.engine.setTrackRate(trackIndex, rateCombo.getSelectedId() - 2); // Id 1 = Global (-1)
+        owner.forceSave();
+    };
+    
+    // Per-track length (0 = follow the Steps knob)
+    addAndMakeVisible(lengthSlider);
+    lengthSlider.setSliderStyle(juce::Slider::LinearBar);
+    lengthSlider.setRange(0.0, SequencerCore::MAX_STEPS, 1.0);
+    lengthSlider.setMouseDragSensitivity(400);
+    lengthSlider.setTooltip("Track Length");
+    lengthSlider.textFromValueFunction = [](double value) {
+        return value < 1.0 ? juce::String("Global") : juce::String((int)value) + " st";
+    };
+    lengthSlider.onValueChange = [this] {
+        if (trackIndex < 0) return;
+        owner.engine.setTrackLength(trackIndex, (int)lengthSlider.getValue());
+        if (trackIndex == owner.engine.currentTrack) owner.updateInspector();
+        owner.forceSave();
+    };
+    
+    // Output channel
+    addAndMakeVisible(channelCombo);
+    for (int ch = 1; ch <= 16; ++ch) channelCombo.addItem("Ch " + juce::String(ch), ch);
+    channelCombo.setTooltip("MIDI Output Channel");
+    channelCombo.onChange = [this] {
+        if (trackIndex < 0) return;
+        owner.engine.setTrackChannel(trackIndex, channelCombo.getSelectedId());
+        owner.forceSave();
+    };
+    
+    // Base note remap (what the editor's C4 plays - e.g. C1 for a Drum Rack)
+    addAndMakeVisible(baseNoteSlider);
+    baseNoteSlider.setSliderStyle(juce::Slider::LinearBar);
+    baseNoteSlider.setRange(0.0, 127.0, 1.0);
+    baseNoteSlider.setMouseDragSensitivity(200);
+    baseNoteSlider.setTooltip("Base Note (C4 in the editor plays this note)");
+    baseNoteSlider.textFromValueFunction = [](double value) {
+        return juce::MidiMessage::getMidiNoteName((int)value, true, true, 4);
+    };
+    baseNoteSlider.onValueChange = [this] {
+        if (trackIndex < 0) return;
+        owner.engine.setTrackBaseNote(trackIndex, (int)baseNoteSlider.getValue());
+        owner.forceSave();
+    };
+}
+
+void StepSequencerAudioProcessorEditor::TrackRow::update(int newTrackIndex)
+{
+    auto& engine = owner.engine;
+    if (newTrackIndex < 0 || newTrackIndex >= engine.getNumTracks()) return;
+    
+    if (newTrackIndex != trackIndex) {
+        trackIndex = newTrackIndex;
+        selectButton.setButtonText(juce::String(trackIndex + 1));
+    }
+    
+    selectButton.setToggleState(trackIndex == engine.currentTrack, juce::dontSendNotification);
+    enableButton.setToggleState(engine.isTrackEnabled(trackIndex), juce::dontSendNotification);
+    repeatSlider.setValue(engine.trackRepeat[(size_t)trackIndex], juce::dontSendNotification);
+    rateCombo.setSelectedId(engine.trackRate[(size_t)trackIndex] + 2, juce::dontSendNotification);
+    lengthSlider.setValue(engine.trackLength[(size_t)trackIndex], juce::dontSendNotification);
+    channelCombo.setSelectedId(engine.trackChannel[(size_t)trackIndex], juce::dontSendNotification);
+    baseNoteSlider.setValue(engine.trackBaseNote[(size_t)trackIndex], juce::dontSendNotification);
+}
+
+void StepSequencerAudioProcessorEditor::TrackRow::resized()
+{
+    auto trackRow = getLocalBounds().withTrimmedBottom(5);
+    
+    // Bottom line: output channel and base note
+    auto outputRow = trackRow.removeFromBottom(22);
+    channelCombo.setBounds(outputRow.removeFromLeft(70));
+    outputRow.removeFromLeft(5);
+    baseNoteSlider.setBounds(outputRow.removeFromLeft(65));
+    trackRow.removeFromBottom(3);
+    
+    // Second line: rate and length
+    auto settingsRow = trackRow.removeFromBottom(22);
+    rateCombo.setBounds(settingsRow.removeFromLeft(70));
+    settingsRow.removeFromLeft(5);
+    lengthSlider.setBounds(settingsRow.removeFromLeft(65));
+    trackRow.removeFromBottom(3);
+    
+    selectButton.setBounds(trackRow.removeFromLeft(40).removeFromTop(30));
+    trackRow.removeFromLeft(5);
+    
+    // Toggle On/Off
+    enableButton.setBounds(trackRow.removeFromLeft(40).removeFromTop(30));
+    trackRow.removeFromLeft(5);
+    
+    // Repeat Slider
+    repeatSlider.setBounds(trackRow.removeFromLeft(50));
 }
 
 void StepSequencerAudioProcessorEditor::updateInspector()
 {
     // Safety check
-    if (!audioProcessor.steps || audioProcessor.steps->empty()) {
+    if (!engine.steps || engine.steps->empty()) {
         return;
     }
     
-    // Sync per-step sliders with current track's steps
-    int numSteps = (int)*audioProcessor.apvts.getRawParameterValue("numSteps");
+    // Sync per-step sliders with current track's steps (current page)
+    int numSteps = getDisplayedLength();
     for (int i = 0; i < MAX_STEP_KNOBS; ++i) {
-        if (i < numSteps && i < (int)STEPS.size()) {
-            stepVelocityKnobs[i].setValue(STEPS[i].velocity, juce::dontSendNotification);
-            stepProbabilityKnobs[i].setValue(STEPS[i].prob, juce::dontSendNotification);
+        int stepIndex = getPageStart() + i;
+        if (stepIndex < numSteps) {
+            stepVelocityKnobs[i].setValue(STEP_AT(stepIndex).velocity, juce::dontSendNotification);
+            stepProbabilityKnobs[i].setValue(getLowerSliderValue(STEP_AT(stepIndex)), juce::dontSendNotification);
         }
     }
     
     // Trigger resized to show/hide controls based on step count
     resized();
 }
+
+void StepSequencerAudioProcessorEditor::showLfo(int lfoIndex)
+{
+    shownLfo = lfoIndex;
+    lfoSelectButton.setButtonText("LFO " + juce::String(lfoIndex + 1));
+    
+    // Drop the old attachments before binding the same controls to the other LFO's parameters
+    lfoShapeAttachment.reset();
+    lfoRateAttachment.reset();
+    lfoTargetAttachment.reset();
+    lfoDepthAttachment.reset();
+    
+    auto& apvts = audioProcessor.apvts;
+    lfoShapeAttachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(apvts, StepSequencerAudioProcessor::getLfoParamId(lfoIndex, "Shape"), lfoShapeCombo));
+    lfoRateAttachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(apvts, StepSequencerAudioProcessor::getLfoParamId(lfoIndex, "Rate"), lfoRateCombo));
+    lfoTargetAttachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(apvts, StepSequencerAudioProcessor::getLfoParamId(lfoIndex, "Target"), lfoTargetCombo));
+    lfoDepthAttachment.reset(new juce::AudioProcessorValueTreeState::SliderAttachment(apvts, StepSequencerAudioProcessor::getLfoParamId(lfoIndex, "Depth"), lfoDepthSlider));
+}
+
+void StepSequencerAudioProcessorEditor::configureLowerSliders()
+{
+    // Lane range starts one below zero: the bottom of the slider is "not set"
+    for (int i = 0; i < MAX_STEP_KNOBS; ++i) {
+        auto& slider = stepProbabilityKnobs[i];
+        if (lowerSliderLane < 0) {
+            slider.setName("Probability");
+            slider.setRange(0.0, 1.0, 0.01);
+            slider.setDoubleClickReturnValue(false, 1.0);
+        } else {
+            slider.setName("Lane");
+            slider.setRange(SequencerCore::LANE_OFF, SequencerCore::getLaneMaximum(lowerSliderLane), 1);
+            slider.setDoubleClickReturnValue(true, SequencerCore::LANE_OFF);
+        }
+    }
+    updateInspector();
+    repaint();
+}
+
+double StepSequencerAudioProcessorEditor::getLowerSliderValue(const SequencerCore::Step& step) const
+{
+    if (lowerSliderLane < 0) return step.prob;
+    return step.lanes[(size_t)lowerSliderLane];
+}
@@ -8,22 +8,29 @@
 #pragma once
 #include <juce_audio_processors/juce_audio_processors.h>
 #include "PluginProcessor.h"
+#include <array>
 
 //==============================================================================
 //==============================================================================
-class StepSequencerAudioProcessorEditor : public juce::AudioProcessorEditor, private juce::Timer
+class StepSequencerAudioProcessorEditor : public juce::AudioProcessorEditor, private juce::Timer, private juce::ListBoxModel
 {
 public:
     StepSequencerAudioProcessorEditor (StepSequencerAudioProcessor&);
     ~StepSequencerAudioProcessorEditor() override;
 
     void paint (juce::Graphics&) override;
+    void paintOverChildren (juce::Graphics&) override;
     void resized() override;
     void timerCallback() override;
     
     // Interactions
     void mouseDown(const juce::MouseEvent& event) override;
     void mouseDoubleClick(const juce::MouseEvent& event) override;
+    void mouseDrag(const juce::MouseEvent& event) override;
+    void mouseUp(const juce::MouseEvent& event) override;
+    void mouseMove(const juce::MouseEvent& event) override;
+    void mouseExit(const juce::MouseEvent& event) override;
+    void mouseWheelMove(const juce::MouseEvent& event, const juce::MouseWheelDetails& wheel) override;
     
     // Helper (public so processor can call on state restore)
     void updateInspector();
@@ -45,10 +52,16 @@ public:
 
 private:
     StepSequencerAudioProcessor& audioProcessor;      // Declare ref first
+    SequencerEngine& engine;                          // Tracks, arrangement and playhead
     std::vector<int> selectedSteps; // Multi-selection support
 
-    // Per-step controls (32 steps max = 2 rows of 16)
+    // Per-step controls (one page = 32 steps = 2 rows of 16)
     static const int MAX_STEP_KNOBS = 32;
+    int currentPage = 0;
+    int getPageStart() const { return currentPage * MAX_STEP_KNOBS; }
+    int getNumPages() const;
+    int getDisplayedLength() const; // Current track's pattern length
+    void setPage(int page);
     juce::Slider stepVelocityKnobs[MAX_STEP_KNOBS];
     juce::Slider stepGateKnobs[MAX_STEP_KNOBS];
     juce::Slider stepProbabilityKnobs[MAX_STEP_KNOBS];
@@ -83,18 +96,151 @@ private:
     juce::TextButton reverseButton;
     juce::ComboBox euclideanCombo;
     juce::Label euclideanLabel;
+    
+    // Page navigation for long patterns
+    juce::TextButton pagePrevButton;
+    juce::TextButton pageNextButton;
+    juce::TextButton followButton;
+    juce::Label pageLabel;
+    
+    // Song / arrangement
+    juce::ComboBox playModeCombo;
+    juce::TextButton songAddButton;
+    juce::TextButton songClearButton;
+    
+    // MIDI input
+    juce::ComboBox inputModeCombo;
+    juce::ComboBox inputHoldCombo;
+    juce::ComboBox inputApplyCombo;
+    
+    // Step recording
+    juce::ComboBox recordCombo;
+    int lastRecordedEditCount = 0;
+    int lastDroppedRecordEdits = 0;
+    
+    // Voice limit
+    juce::Slider voiceLimitSlider;
+    juce::ComboBox voiceStealCombo;
+    juce::ComboBox syncCombo;
+    
+    // Automation lanes - the lower per-step slider edits probability or one lane
+    juce::Label laneLabel;
+    juce::ComboBox laneViewCombo;
+    juce::Slider laneCcSlider;
+    juce::ComboBox laneSmoothCombo;
+    int lowerSliderLane = -1;       // -1 = probability, else an AutomationLane
+    void configureLowerSliders();
+    double getLowerSliderValue(const SequencerCore::Step& step) const;
+    
+    // LFOs - one set of controls, switched between LFOs
+    juce::TextButton lfoSelectButton;
+    juce::ComboBox lfoShapeCombo;
+    juce::ComboBox lfoRateCombo;
+    juce::ComboBox lfoTargetCombo;
+    juce::Slider lfoDepthSlider;
+    int shownLfo = 0;
+    void showLfo(int lfoIndex);
+    
+    // Performance overlay - drains the processor's per-block telemetry
+    juce::TextButton perfButton;
+    juce::TextButton perfExportButton;
+    static const int MAX_PERF_HISTORY = 60000;  // Blocks kept for CSV export (~10 min at 512 / 48 kHz)
+    std::vector<StepSequencerAudioProcessor::BlockStats> perfHistory;
+    std::array<StepSequencerAudioProcessor::BlockStats, 256> perfScratch;
+    std::unique_ptr<juce::FileChooser> perfFileChooser;
+    void drainTelemetry();
+    void paintPerfOverlay(juce::Graphics& g);
+    void exportPerfCsv();
 
-    // Track System (left sidebar) - dynamic
+    // Track System (left sidebar) - virtualised list, rows exist only for visible tracks
+    class TrackRow : public juce::Component
+    {
+    public:
+        explicit TrackRow(StepSequencerAudioProcessorEditor& owner);
+        void update(int newTrackIndex); // Rebind a recycled row to a track
+        void resized() override;
+        
+    private:
+        StepSequencerAudioProcessorEditor& owner;
+        int trackIndex = -1;
+        juce::TextButton selectButton;  // Track number, highlighted when current
+        juce::TextButton enableButton;  // Toggle track on/off
+        juce::Slider repeatSlider;      // Repeat count (1-16)
+        juce::ComboBox rateCombo;       // Track rate ("Global" = Rate knob)
+        juce::Slider lengthSlider;      // Track length (0 = Steps knob)
+        juce::ComboBox channelCombo;    // MIDI output channel 1-16
+        juce::Slider baseNoteSlider;    // Base-note remap
+    };
+    
+    // ListBoxModel
+    int getNumRows() override;
+    void paintListBoxItem(int rowNumber, juce::Graphics& g, int width, int height, bool rowIsSelected) override;
+    juce::Component* refreshComponentForRow(int rowNumber, bool isRowSelected, juce::Component* existingComponentToUpdate) override;
+    void trackSelected(int trackIndex);
+    
     juce::Label tracksLabel;        // Shows "Tracks: 2" or similar
-    std::vector<std::unique_ptr<juce::TextButton>> trackButtons; // Radio buttons to switch view
-    std::vector<std::unique_ptr<juce::TextButton>> trackEnableButtons; // Toggle track on/off
-    std::vector<std::unique_ptr<juce::Slider>> trackRepeatSliders; // Repeat count for each track (1-16)
+    juce::ListBox trackList;
+    int displayedTrack = -1;        // Track highlighted in the list
     juce::TextButton addTrackButton; // "+" button to add tracks
     juce::TextButton duplicateTrackButton; // "Dup" button to duplicate current track
     juce::TextButton removeTrackButton; // "-" button to remove tracks
     
     juce::Rectangle<int> stepGridArea;
     juce::Rectangle<int> pianoArea;
+    juce::Rectangle<int> songArea;          // Arrangement timeline strip
+
+    float getSongBarWidth() const;
+    int getSongEntryAt(juce::Point<int> pos) const;   // -1 if not over an entry
+    void paintSongTimeline(juce::Graphics& g);
+
+    // Hit-test layout (computed once in resized(), shared by paint and mouse handling)
+    static const int PIANO_START_NOTE = 48; // C3
+    static const int PIANO_END_NOTE = 72;   // C5
+    struct PianoKey { int note; bool isBlack; juce::Rectangle<float> bounds; };
+    std::vector<PianoKey> pianoKeys;        // White keys first, then black keys (paint order)
+    std::vector<int> pianoNoteByXUpper;     // Note under each pixel column in the black-key band
+    std::vector<int> pianoNoteByXLower;     // Note under each pixel column below the black keys
+    float pianoBlackKeyHeight = 0.0f;
+
+    struct StepCell { juce::Rectangle<float> lane; juce::Rectangle<float> button; };
+    std::vector<StepCell> stepCells;        // One per visible step
+    int layoutNumSteps = 0;                 // Pattern length the layout was built for
+    int layoutPageStart = 0;                // Absolute index of the first cell
+    int layoutStepsPerRow = 16;
+    float layoutLaneWidth = 0.0f;
+    float layoutRowHeight = 0.0f;
+
+    void updateHitTestLayout();
+    int getNoteAt(juce::Point<int> pos) const;        // -1 if not over a key
+    int getStepButtonAt(juce::Point<int> pos) const;  // -1 if not over a step button
+    void applyNoteToSelection(int note);
+    void selectStep(int stepIndex, bool addToSelection);
+    void forceSave();
+
+    // Cached label text (glyph layout done once per font size, reused every frame)
+    struct CachedLabel { juce::GlyphArrangement glyphs; juce::Rectangle<float> bounds; };
+    std::array<CachedLabel, 128> noteNameLabels;   // Step buttons: getMidiNoteName for every MIDI note
+    std::array<CachedLabel, 11> pianoOctaveLabels; // Piano: "C-1" .. "C9"
+    std::vector<CachedLabel> beatNumberLabels;     // Grid: "1", "2", ...
+    struct SongEntryLabel { int pattern = -1; int repeats = 0; int transpose = 0; CachedLabel label; };
+    std::vector<SongEntryLabel> songEntryLabels;   // Song timeline: "T1 x2 +5", per entry
+    float noteLabelFontHeight = 0.0f;
+    float beatLabelFontHeight = 0.0f;
+    float pianoLabelFontHeight = 0.0f;
+
+    void updateLabelCache();
+    const CachedLabel& getBeatLabel(int beatIndex);
+    const CachedLabel& getSongEntryLabel(int entryIndex);
+    static void makeCachedLabel(CachedLabel& label, const juce::Font& font, const juce::String& text);
+    static void drawCachedLabel(juce::Graphics& g, const CachedLabel& label, juce::Rectangle<float> area, juce::Justification justification);
+
+    // Mouse interaction state
+    enum class DragMode { None, PaintNotes, SelectSteps, NudgeTiming };
+    DragMode dragMode = DragMode::None;
+    int nudgeStep = -1;             // Step whose micro-timing is being dragged
+    float nudgeStartOffset = 0.0f;
+    int hoveredStep = -1;
+    int hoveredNote = -1;
 
     // Helper function to check if note is in scale
     bool isNoteInScale(int midiNote, int rootNote, int scaleType);
@@ -108,6 +254,20 @@ private:
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> swingAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> keyAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> scaleAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> playModeAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> voiceLimitAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> voiceStealAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> syncAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> inputModeAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> inputHoldAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> inputApplyAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> recordAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> laneCcAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> laneSmoothAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> lfoShapeAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> lfoRateAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> lfoTargetAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> lfoDepthAttachment;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StepSequencerAudioProcessorEditor)
 };
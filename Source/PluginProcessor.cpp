@@ -8,10 +8,14 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 #include <algorithm>
+#include <limits>
 #include <fstream>
 #include <iostream>
 #include <chrono>
 #include <ctime>
+#include <mutex>
+
+using namespace SequencerCore;
 
 //==============================================================================
 StepSequencerAudioProcessor::StepSequencerAudioProcessor()
@@ -21,24 +25,40 @@ StepSequencerAudioProcessor::StepSequencerAudioProcessor()
                        ),
        apvts (*this, nullptr, "Parameters", createParams())
 {
-    // Initialize all tracks
-    // Initialize with 1 track by default
-    tracks.resize(1);
-    trackRepeat.resize(1, 1);
-    trackEnabled.resize(1, true);
-    
-    tracks[0].resize(32);
-    for (auto& s : tracks[0]) {
-        s.active = false; // Default to silence
-        s.note = 60; // C3
-        s.velocity = 100;
-        s.gate = 0.5f;
+    // Parameter values the audio thread reads, looked up by id once here (the lookup builds a String)
+    inputApplyParam = apvts.getRawParameterValue("inputApply");
+    inputHoldParam = apvts.getRawParameterValue("inputHold");
+    inputModeParam = apvts.getRawParameterValue("inputMode");
+    keyParam = apvts.getRawParameterValue("key");
+    laneCcParam = apvts.getRawParameterValue("laneCc");
+    laneSmoothParam = apvts.getRawParameterValue("laneSmooth");
+    legacyNumStepsParam = apvts.getRawParameterValue("numSteps");
+    legacyRateParam = apvts.getRawParameterValue("rate");
+    numStepsParam = apvts.getRawParameterValue("steps");
+    octaveParam = apvts.getRawParameterValue("octave");
+    playModeParam = apvts.getRawParameterValue("playMode");
+    rateParam = apvts.getRawParameterValue("stepRate");
+    recordModeParam = apvts.getRawParameterValue("recordMode");
+    scaleParam = apvts.getRawParameterValue("scale");
+    syncSourceParam = apvts.getRawParameterValue("syncSource");
+    voiceLimitParam = apvts.getRawParameterValue("voiceLimit");
+    voiceStealParam = apvts.getRawParameterValue("voiceSteal");
+    
+    updateGlobalTiming();
+    
+    for (int l = 0; l < SequencerCore::NUM_LFOS; ++l) {
+        lfoParameters[(size_t)l] = { apvts.getRawParameterValue(getLfoParamId(l, "Shape")),
+                                     apvts.getRawParameterValue(getLfoParamId(l, "Rate")),
+                                     apvts.getRawParameterValue(getLfoParamId(l, "Target")),
+                                     apvts.getRawParameterValue(getLfoParamId(l, "Depth")) };
     }
-    steps = &tracks[0]; // Point to first track
+    
+    startTimerHz(30); // Applies recorded steps
 }
 
 StepSequencerAudioProcessor::~StepSequencerAudioProcessor()
 {
+    stopTimer();
 }
 
 //==============================================================================
@@ -48,11 +68,20 @@ juce::AudioProcessorValueTreeState::ParameterLayout StepSequencerAudioProcessor:
     
     // Global Parameters
     params.push_back(std::make_unique<juce::AudioParameterInt>(
-        juce::ParameterID("numSteps", 1), "Steps", 1, 32, 16));
+        juce::ParameterID("steps", 2), "Steps", 1, MAX_STEPS, 16));
 
     params.push_back(std::make_unique<juce::AudioParameterChoice>(
-        juce::ParameterID("rate", 1), "Rate",
-        juce::StringArray { "1/4", "1/8", "1/16", "1/32" }, 2)); // Default 1/16
+        juce::ParameterID("stepRate", 2), "Rate",
+        getRateNames(), 2)); // Default 1/16 (triplet / dotted choices appended after the originals)
+
+    // The original step count (1 - 32) and rate (straight notes only), kept with their ranges so
+    // existing automation still means the same thing; whichever of old and new moved last plays
+    params.push_back(std::make_unique<juce::AudioParameterInt>(
+        juce::ParameterID("numSteps", 1), "Steps (legacy)", 1, 32, 16));
+
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("rate", 1), "Rate (legacy)",
+        juce::StringArray { "1/4", "1/8", "1/16", "1/32" }, 2));
         
     params.push_back(std::make_unique<juce::AudioParameterFloat>(
         juce::ParameterID("swing", 1), "Swing", 0.0f, 100.0f, 0.0f));
@@ -68,6 +97,63 @@ juce::AudioProcessorValueTreeState::ParameterLayout StepSequencerAudioProcessor:
     params.push_back(std::make_unique<juce::AudioParameterInt>(
         juce::ParameterID("octave", 1), "Octave", -3, 3, 0)); // Default 0
 
+    params.push_back(std::make_unique<juce::AudioParameterInt>(
+        juce::ParameterID("voiceLimit", 1), "Voices", 1, SequencerEngine::MAX_VOICES_PER_CHANNEL, 16)); // Per channel
+
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("voiceSteal", 1), "Voice Steal",
+        juce::StringArray { "Oldest", "Quietest" }, 0));
+
+    // MIDI input: transpose / key-follow from a keyboard
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("inputMode", 1), "MIDI In",
+        juce::StringArray { "Off", "Transpose", "Key" }, 0));
+
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("inputHold", 1), "MIDI In Hold",
+        juce::StringArray { "Latch", "Hold", "Gate" }, 0));
+
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("inputApply", 1), "MIDI In Apply",
+        juce::StringArray { "Next Step", "Current Note" }, 0));
+
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("recordMode", 1), "Record",
+        juce::StringArray { "Off", "Overdub", "Replace" }, 0));
+
+    // Automation lanes: which CC the CC lane drives, and how finely lanes glide between steps
+    params.push_back(std::make_unique<juce::AudioParameterInt>(
+        juce::ParameterID("laneCc", 1), "Lane CC", 0, 119, 1)); // Default mod wheel
+
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("laneSmooth", 1), "Lane Smoothing",
+        getLaneResolutionNames(), 0)); // Off = one value per step
+
+    // LFOs: modulate step values at trigger time, synced to the host position
+    for (int l = 0; l < NUM_LFOS; ++l) {
+        juce::String prefix = "LFO " + juce::String(l + 1) + " ";
+        params.push_back(std::make_unique<juce::AudioParameterChoice>(
+            juce::ParameterID(getLfoParamId(l, "Shape"), 1), prefix + "Shape",
+            juce::StringArray { "Sine", "Triangle", "Saw", "Square", "S&H" }, 0));
+        params.push_back(std::make_unique<juce::AudioParameterChoice>(
+            juce::ParameterID(getLfoParamId(l, "Rate"), 1), prefix + "Rate",
+            getLfoRateNames(), 2)); // Default 1 bar
+        params.push_back(std::make_unique<juce::AudioParameterChoice>(
+            juce::ParameterID(getLfoParamId(l, "Target"), 1), prefix + "Target",
+            juce::StringArray { "Off", "Velocity", "Gate", "Probability", "Note", "Octave" }, 0));
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(
+            juce::ParameterID(getLfoParamId(l, "Depth"), 1), prefix + "Depth", 0.0f, 100.0f, 50.0f));
+    }
+
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("playMode", 1), "Play Mode",
+        juce::StringArray { "Chain", "Song", "Layer" }, 0)); // Chain = round-robin of enabled tracks, Song = arrangement, Layer = all enabled tracks at once
+
+    // Transport / tempo from the host, or from MIDI clock arriving on the MIDI input
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("syncSource", 1), "Sync",
+        juce::StringArray { "Host", "MIDI Clock" }, 0));
+
     // Hidden parameter to force DAW to detect state changes
     params.push_back(std::make_unique<juce::AudioParameterInt>(
         juce::ParameterID("_stateVersion", 1), "_StateVersion", 0, 999999, 0));
@@ -89,15 +175,27 @@ void StepSequencerAudioProcessor::changeProgramName (int index, const juce::Stri
 //==============================================================================
 void StepSequencerAudioProcessor::prepareToPlay (double sRate, int samplesPerBlock)
 {
-    juce::ignoreUnused(samplesPerBlock);
     sampleRate = (sRate > 0.0) ? sRate : 44100.0;
-    accumulatedSamples = 0.0;
-    currentStepIndex = 0;
-    samplesRemainingForGate = 0;
-    lastNote = -1;
+    
+    // Engine output sized for the worst block we expect; the host buffer gets the same reserve
+    // (ensureSize in copyToHost only allocates the first time a given host buffer is too small)
+    engine.prepare(sampleRate, samplesPerBlock);
+    midiOutReserveBytes = engine.getOutputCapacity() * 9 + 2048; // 3 data + 6 header bytes per event, plus the input
+    
+    // Keep the input hand-over allocation-free on the audio thread
+    inputEvents.assign(2048, {});
+    hostPassThrough.ensureSize(2048);
+    
+    updateGlobalTiming();
+    clockFollower.reset(sampleRate);
+    clockSamplePosition = 0.0;
 }
 
-void StepSequencerAudioProcessor::releaseResources() {}
+void StepSequencerAudioProcessor::releaseResources()
+{
+    // No MIDI can go out from here - the engine keeps the notes and the next block releases them
+    engine.releaseNotesOnNextBlock();
+}
 
 #ifndef JucePlugin_PreferredChannelConfigurations
 bool StepSequencerAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
@@ -111,167 +209,268 @@ bool StepSequencerAudioProcessor::isBusesLayoutSupported (const BusesLayout& lay
 
 void StepSequencerAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    const RealtimeGuard::ScopedRealtimeSection realtimeSection; // Debug: report allocations / locks
+    auto startTicks = juce::Time::getHighResolutionTicks();
+    
     // Clear dummy audio buffer to silence
     buffer.clear();
+    const int numSamples = buffer.getNumSamples();
+    
+    BlockStats stats;
+    stats.numSamples = numSamples;
+    stats.sampleRate = sampleRate;
+    
+    // MIDI clock sync needs no playhead - position and tempo come from the input
+    const bool clockSync = (int)*syncSourceParam == SyncMidiClock;
+    if (getPlayHead() == nullptr && !clockSync) return;
+    
+    SequencerEngine::Transport transport;
+    readTransport(midiMessages, numSamples, transport);
+    
+    // MIDI input drives transposition / recording: the engine takes the incoming notes out of
+    // the host buffer and handles them in time order with its own events
+    numInputEvents = 0;
+    if ((int)*inputModeParam != SequencerEngine::InputOff || (int)*recordModeParam != SequencerEngine::RecordOff || clockSync)
+        takeInputMidi(midiMessages, clockSync);
+    
+    updateGlobalTiming();
+    engine.setSettings(readSettings());
+    engine.setOverflowHandler(&StepSequencerAudioProcessor::addOverflowEvent, &midiMessages);
+    const auto events = engine.process(numSamples, transport, inputEvents.data(), numInputEvents);
+    copyToHost(events, midiMessages);
+    
+    const auto& info = engine.getBlockInfo();
+    stats.stepsCrossed = info.stepsCrossed;
+    stats.maxOnsetError = info.maxOnsetError;
+    stats.eventsEmitted = events.size();
+    stats.elapsedNs = (juce::int64)(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) * 1.0e9);
+    
+    // Dropped if the editor isn't draining (closed) - telemetry must never block the audio thread
+    const auto scope = telemetryFifo.write(1);
+    if (scope.blockSize1 > 0) telemetryBuffer[(size_t)scope.startIndex1] = stats;
+}
+
+void StepSequencerAudioProcessor::processBlockBypassed (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    const RealtimeGuard::ScopedRealtimeSection realtimeSection;
+    
+    // Bypassed: nothing may keep sounding - release our notes and pick up fresh when re-enabled
+    buffer.clear();
+    engine.setOverflowHandler(&StepSequencerAudioProcessor::addOverflowEvent, &midiMessages);
+    copyToHost(engine.processBypassed(), midiMessages);
+}
 
-    juce::AudioPlayHead* playHead = getPlayHead();
-    if (!playHead) return;
+int StepSequencerAudioProcessor::popBlockStats(BlockStats* dest, int maxCount)
+{
+    const auto scope = telemetryFifo.read(juce::jmin(maxCount, telemetryFifo.getNumReady()));
+    for (int i = 0; i < scope.blockSize1; ++i) dest[i] = telemetryBuffer[(size_t)(scope.startIndex1 + i)];
+    for (int i = 0; i < scope.blockSize2; ++i) dest[scope.blockSize1 + i] = telemetryBuffer[(size_t)(scope.startIndex2 + i)];
+    return scope.blockSize1 + scope.blockSize2;
+}
 
-    bool hostIsPlaying = false;
-    double hostBPM = 120.0;
+SequencerEngine::Settings StepSequencerAudioProcessor::readSettings() const
+{
+    SequencerEngine::Settings s;
+    s.playMode = (int)*playModeParam;
+    s.key = (int)*keyParam;
+    s.scale = (int)*scaleParam;
+    s.octave = (int)*octaveParam;
+    s.voiceLimit = (int)*voiceLimitParam;
+    s.voiceSteal = (int)*voiceStealParam;
+    s.laneCc = (int)*laneCcParam;
+    s.laneSmooth = (int)*laneSmoothParam;
+    s.inputMode = (int)*inputModeParam;
+    s.inputHold = (int)*inputHoldParam;
+    s.inputApply = (int)*inputApplyParam;
+    s.recordMode = (int)*recordModeParam;
+    for (int l = 0; l < SequencerCore::NUM_LFOS; ++l) {
+        const auto& lfo = lfoParameters[(size_t)l];
+        s.lfos[(size_t)l] = { (int)*lfo.shape, (int)*lfo.rate, (int)*lfo.target, lfo.depth->load() };
+    }
+    return s;
+}
+
+void StepSequencerAudioProcessor::updateGlobalTiming()
+{
+    // Legacy rate choices are the first entries of the current list: same index, same rate
+    engine.setGlobalNumSteps(globalNumSteps.update((int)*legacyNumStepsParam, (int)*numStepsParam));
+    engine.setGlobalRate(globalRate.update((int)*legacyRateParam, (int)*rateParam));
+}
+
+int StepSequencerAudioProcessor::LatestOf::update(int legacy, int current)
+{
+    if (lastLegacy.exchange(legacy) != legacy) value = legacy;
+    if (lastCurrent.exchange(current) != current) value = current; // Both moved: the current one wins
+    return value;
+}
+
+void StepSequencerAudioProcessor::LatestOf::reset()
+{
+    lastLegacy = -1;
+    lastCurrent = -1;
+}
 
+void StepSequencerAudioProcessor::readTransport(const juce::MidiBuffer& midi, int numSamples, SequencerEngine::Transport& transport)
+{
+    if ((int)*syncSourceParam == SyncMidiClock) {
+        transport.hasPosition = true;
+        transport.estimateRamp = false; // The clock's position is already steered block to block
+        transport.isPlaying = readMidiClock(midi, numSamples, transport.ppq, transport.bpm, transport.stopOffset);
+        return;
+    }
+    
     // Modern PlayHead API
-    if (auto positionOpt = playHead->getPosition())
-    {
-        const auto& pos = *positionOpt;
-        
-        if (auto ts = pos.getTimeSignature()) {
-            timeSignatureNumerator = ts->numerator;
-            timeSignatureDenominator = ts->denominator;
-        }
-        
-        if (auto bpm = pos.getBpm()) {
-            hostBPM = *bpm;
-        }
-        
-        hostIsPlaying = pos.getIsPlaying();
+    auto* playHead = getPlayHead();
+    if (playHead == nullptr) return;
+    auto positionOpt = playHead->getPosition();
+    if (!positionOpt) return;
+    
+    const auto& pos = *positionOpt;
+    if (auto ts = pos.getTimeSignature()) {
+        transport.hasTimeSignature = true;
+        transport.numerator = ts->numerator;
+        transport.denominator = ts->denominator;
+    }
+    if (auto bpm = pos.getBpm()) transport.bpm = *bpm;
+    if (auto ppq = pos.getPpqPosition()) {
+        transport.hasPosition = true;
+        transport.ppq = *ppq;
     }
     
-    // Check state change
-    if (!hostIsPlaying) {
-        // Send All Notes Off if we just stopped
-        if (isPlaying) {
-            midiMessages.addEvent(juce::MidiMessage::allNotesOff(1), 0);
-            isPlaying = false;
-            samplesRemainingForGate = 0;
-            accumulatedSamples = 0;
-            
-            // RESET TO START: Go back to track 1, step 1
-            currentStepIndex = 0;
-            barsPlayedOnCurrentTrack = 0;
-            beatsPlayedInCurrentBar = 0;
-            switchToTrack(0); // Back to first track
+    // Prefer the host's own bar numbering when it reports one
+    if (auto barStart = pos.getPpqPositionOfLastBarStart()) {
+        if (auto barCount = pos.getBarCount()) {
+            transport.hasBar = true;
+            transport.barCount = *barCount;
+            transport.barStartPpq = *barStart;
         }
-        return;
     }
     
-    // Just started playing - ensure we're at the beginning
-    if (!isPlaying) {
-        currentStepIndex = 0;
-        barsPlayedOnCurrentTrack = 0;
-        beatsPlayedInCurrentBar = 0;
-        accumulatedSamples = 0;
+    transport.isPlaying = pos.getIsPlaying();
+}
+
+bool StepSequencerAudioProcessor::readMidiClock(const juce::MidiBuffer& midi, int numSamples, double& blockStartPpq, double& bpm, int& stopOffset)
+{
+    // Clock and transport messages go to the follower at their exact sample times
+    const double blockStart = clockSamplePosition;
+    clockSamplePosition += numSamples;
+    const bool wasRunning = clockFollower.isRunning();
+    for (const auto metadata : midi) {
+        const auto message = metadata.getMessage();
+        const double time = blockStart + metadata.samplePosition;
+        if (message.isMidiClock()) clockFollower.clock(time);
+        else if (message.isMidiStart()) clockFollower.start();
+        else if (message.isMidiContinue()) clockFollower.continuePlayback();
+        else if (message.isSongPositionPointer()) clockFollower.setSongPosition(message.getSongPositionPointerMidiBeat());
+        else if (message.isMidiStop()) {
+            if (clockFollower.isRunning() && stopOffset < 0) stopOffset = metadata.samplePosition;
+            clockFollower.stop();
+        }
     }
     
-    isPlaying = true;
-    currentBPM = hostBPM > 0 ? hostBPM : 120.0;
-    
-    // Calculate Timing
-    double samplesPerMinute = sampleRate * 60.0;
-    double currentSamplesPerBeat = samplesPerMinute / currentBPM;
-    
-    // Rate Multiplier (simplified for 1/16 default)
-    int rateIndex = (int) *apvts.getRawParameterValue("rate");
-    double rateMult = 1.0;
-    if (rateIndex == 0) rateMult = 1.0; // 1/4 (1 beat)
-    else if (rateIndex == 1) rateMult = 0.5; // 1/8
-    else if (rateIndex == 2) rateMult = 0.25; // 1/16
-    else if (rateIndex == 3) rateMult = 0.125; // 1/32
-    
-    double samplesPerStep = currentSamplesPerBeat * rateMult;
-    
-    // Safety check
-    if (samplesPerStep < 32.0) samplesPerStep = 32.0;
-
-    int numSamples = buffer.getNumSamples();
-    int sampleOffset = 0;
-    
-    while (sampleOffset < numSamples)
-    {
-        // 1. Handle Note Offs
-        if (samplesRemainingForGate > 0) {
-            samplesRemainingForGate--;
-            if (samplesRemainingForGate == 0 && lastNote != -1) {
-                midiMessages.addEvent(juce::MidiMessage::noteOff(1, lastNote), sampleOffset);
-                lastNote = -1;
-            }
-        }
+    const bool running = clockFollower.isRunning();
+    if (running) stopOffset = -1; // Stopped and started again within the block: keep going
+    if (!running && stopOffset < 0) return false;
+    
+    // Keep the position continuous while following: start where the last block ended and pick
+    // the tempo that ends this block where the loop puts it, so corrections glide rather than jump.
+    // A fresh start / continue, or drifting a whole clock away, takes the loop's position directly.
+    const double nominal = clockFollower.getQuartersPerSample();
+    const double loopStartPpq = clockFollower.getPpqAt(blockStart);
+    const bool continuous = engine.isPlaying && wasRunning && clockFollower.getEpoch() == clockEpoch
+                         && std::abs(clockBlockEndPpq - loopStartPpq) < 1.0 / MidiClockFollower::CLOCKS_PER_QUARTER;
+    blockStartPpq = continuous ? clockBlockEndPpq : loopStartPpq;
+    clockEpoch = clockFollower.getEpoch();
+    
+    double quartersPerSample = nominal; // Stopping in this block: the loop's position past Stop means nothing
+    if (running)
+        quartersPerSample = juce::jlimit(nominal * 0.5, nominal * 2.0,
+                                         (clockFollower.getPpqAt(blockStart + numSamples) - blockStartPpq) / juce::jmax(1, numSamples));
+    clockBlockEndPpq = blockStartPpq + quartersPerSample * numSamples;
+    bpm = quartersPerSample * 60.0 * sampleRate;
+    return true;
+}
+
+bool StepSequencerAudioProcessor::isClockMessage(const juce::MidiMessage& message)
+{
+    return message.isMidiClock() || message.isMidiStart() || message.isMidiContinue()
+        || message.isMidiStop() || message.isSongPositionPointer();
+}
+
+void StepSequencerAudioProcessor::takeInputMidi(juce::MidiBuffer& hostMidi, bool clockSync)
+{
+    // Short messages go to the engine (which passes non-notes through in time order); SysEx, and
+    // anything past the preallocated input, stays in the host buffer untouched
+    hostPassThrough.clear();
+    for (const auto metadata : hostMidi) {
+        const auto message = metadata.getMessage();
         
-        // 2. Scheduler logic
-        // If we are at the start of a new step
-        accumulatedSamples += 1.0;
+        // In MIDI clock sync the clock drives us and is not echoed to the output
+        if (clockSync && isClockMessage(message)) continue;
         
-        if (accumulatedSamples >= samplesPerStep) {
-            accumulatedSamples -= samplesPerStep;
-            
-            // Advance Step
-            int numSteps = (int) *apvts.getRawParameterValue("numSteps");
-            
-            // Advance to next step
-            currentStepIndex++;
-            
-            // Check if we finished a full sequence loop
-            if (currentStepIndex >= numSteps) {
-                currentStepIndex = 0;
-                
-                // We completed one full loop
-                barsPlayedOnCurrentTrack++;
-                
-                // Track Switch Logic: Check if we've played enough loops
-                if (barsPlayedOnCurrentTrack >= trackRepeat[currentTrack]) {
-                    barsPlayedOnCurrentTrack = 0;
-                    
-                    // Find next enabled track
-                    int nextTrack = currentTrack;
-                    int numTracks = getNumTracks();
-                    
-                    // Safety break loop
-                    int attempts = 0;
-                    while(attempts < numTracks) {
-                        nextTrack = (nextTrack + 1) % numTracks;
-                        if (trackEnabled[nextTrack]) {
-                            switchToTrack(nextTrack);
-                            break;
-                        }
-                        attempts++;
-                    }
-                }
-            }
-            
-            // Trigger New Note
-            Step& s = (*steps)[currentStepIndex];
-            if (s.active) {
-                // If it's a TIED step, we do NOT trigger a new note. 
-                // We just let the previous note continue ringing (because its gate was long enough).
-                if (!s.isTied) {
-                    // Determine velocity and probability
-                    if (juce::Random::getSystemRandom().nextFloat() <= s.prob) {
-                         // Kill previous note if still ringing (monophonic sequencer)
-                         if (lastNote != -1) {
-                             midiMessages.addEvent(juce::MidiMessage::noteOff(1, lastNote), sampleOffset);
-                         }
-                         
-                         int octaveShift = (int)*apvts.getRawParameterValue("octave");
-                         lastNote = juce::jlimit(0, 127, s.note + (octaveShift * 12));
-                         
-                         midiMessages.addEvent(juce::MidiMessage::noteOn(1, lastNote, (juce::uint8)s.velocity), sampleOffset);
-                         
-                         // Calculate Gate Length
-                         samplesRemainingForGate = (long)(samplesPerStep * s.gate);
-                         
-                         // DEBUG: if gate is large, print it? No console for VST.
-                         // But logic assumes s.gate is e.g. 5.0 for a long tie.
-                    }
-                }
-                // Important: If it IS tied, we don't do anything. 
-                // We rely on samplesRemainingForGate from the previous "START" step to keep counting down.
-                // NOTE: If the user ties steps but the "start" step wasn't set to a long gate, the note will cut off early.
-                // The Editor logic handles setting the start step gate.
-            }
+        if (metadata.numBytes > 3 || numInputEvents >= (int)inputEvents.size()) {
+            hostPassThrough.addEvent(metadata.data, metadata.numBytes, metadata.samplePosition);
+            continue;
         }
-        
-        sampleOffset++;
+        auto& e = inputEvents[(size_t)numInputEvents++];
+        e.sampleOffset = metadata.samplePosition;
+        e.size = (std::uint8_t)metadata.numBytes;
+        for (int i = 0; i < metadata.numBytes; ++i) e.bytes[i] = metadata.data[i];
     }
+    hostMidi.swapWith(hostPassThrough);
+}
+
+void StepSequencerAudioProcessor::copyToHost(SequencerEngine::EventSpan events, juce::MidiBuffer& hostMidi) const
+{
+    hostMidi.ensureSize((size_t)midiOutReserveBytes); // No-op once the host buffer has grown to fit
+    for (const auto& e : events)
+        hostMidi.addEvent(e.bytes, e.size, e.sampleOffset);
+}
+
+void StepSequencerAudioProcessor::addOverflowEvent(void* hostMidi, const std::uint8_t* data, int numBytes, int sampleOffset)
+{
+    // The engine's buffer is full: straight to the host buffer rather than lost
+    static_cast<juce::MidiBuffer*>(hostMidi)->addEvent(data, numBytes, sampleOffset);
+}
+
+void StepSequencerAudioProcessor::timerCallback()
+{
+    // Recorded steps are written on the message thread, where the pattern is normally edited
+    if (engine.applyRecordedEdits() == 0) return;
+    
+    // Force DAW to save
+    apvts.getParameter("swing")->setValueNotifyingHost(apvts.getParameter("swing")->getValue());
+}
+
+const juce::StringArray& StepSequencerAudioProcessor::getLfoRateNames()
+{
+    static const juce::StringArray names { "4 Bars", "2 Bars", "1 Bar", "1/2", "1/4", "1/8", "1/16" };
+    return names;
+}
+
+juce::String StepSequencerAudioProcessor::getLfoParamId(int lfoIndex, const char* name)
+{
+    return "lfo" + juce::String(lfoIndex + 1) + name;
+}
+
+//==============================================================================
+const juce::StringArray& StepSequencerAudioProcessor::getLaneResolutionNames()
+{
+    static const juce::StringArray names { "Off", "4 / step", "8 / step", "16 / step", "32 / step" };
+    return names;
+}
+
+const juce::StringArray& StepSequencerAudioProcessor::getRateNames()
+{
+    static const juce::StringArray names { "1/4", "1/8", "1/16", "1/32", "1/4T", "1/8T", "1/16T", "1/4.", "1/8.", "1/16." };
+    return names;
+}
+
+void StepSequencerAudioProcessor::copyParameterValue(const char* fromId, const char* toId)
+{
+    auto* from = apvts.getParameter(fromId);
+    auto* to = apvts.getParameter(toId);
+    to->setValueNotifyingHost(to->convertTo0to1(from->convertFrom0to1(from->getValue())));
 }
 
 //==============================================================================
@@ -281,22 +480,36 @@ juce::AudioProcessorEditor* StepSequencerAudioProcessor::createEditor() { return
 //==============================================================================
 void StepSequencerAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
+    // The engine data is copied under the structure lock and written out without it
+    const auto snapshot = engine.takeSnapshot();
+    const int numTracks = (int)snapshot.tracks.size();
+
     // Ensure all params are consistent before saving
-    apvts.state.setProperty("numTracks", getNumTracks(), nullptr);
+    apvts.state.setProperty("numTracks", numTracks, nullptr);
     
     // Save Track Data manually or as a child tree
     juce::ValueTree tracksTree("TRACKS");
-    for (int t = 0; t < getNumTracks(); ++t) {
+    for (int t = 0; t < numTracks; ++t) {
+        const auto& track = snapshot.tracks[(size_t)t];
         juce::ValueTree trackNode("TRACK");
         trackNode.setProperty("index", t, nullptr);
-        trackNode.setProperty("repeat", trackRepeat[t], nullptr);
-        trackNode.setProperty("enabled", (bool)trackEnabled[t], nullptr);
+        trackNode.setProperty("repeat", snapshot.trackRepeat[(size_t)t], nullptr);
+        trackNode.setProperty("enabled", snapshot.trackEnabled.test(t), nullptr);
+        trackNode.setProperty("rate", snapshot.trackRate[(size_t)t], nullptr);           // -1 = global
+        trackNode.setProperty("patternLength", snapshot.trackLength[(size_t)t], nullptr); // 0 = global
+        trackNode.setProperty("channel", snapshot.trackChannel[(size_t)t], nullptr);
+        trackNode.setProperty("baseNote", snapshot.trackBaseNote[(size_t)t], nullptr);
+        trackNode.setProperty("length", (int)track.size(), nullptr);
         
         // Save Steps
+        // Only steps that differ from an empty step are written (inactive steps with
+        // edited velocity/prob are still kept); long tracks stay compact.
+        const Step empty = makeEmptyStep();
         juce::ValueTree stepsTree("STEPS");
-        for (int s = 0; s < (int)tracks[t].size(); ++s) {
-            const auto& step = tracks[t][s];
-            // Save ALL steps (not just non-default ones) to ensure velocity/prob changes on inactive steps are preserved
+        for (int s = 0; s < (int)track.size(); ++s) {
+            const auto& step = track[(size_t)s];
+            if (step == empty) continue;
+            
             juce::ValueTree stepNode("STEP");
             stepNode.setProperty("i", s, nullptr);
             stepNode.setProperty("n", step.note, nullptr);
@@ -305,6 +518,12 @@ void StepSequencerAudioProcessor::getStateInformation (juce::MemoryBlock& destDa
             stepNode.setProperty("p", step.prob, nullptr);
             stepNode.setProperty("a", step.active, nullptr);
             stepNode.setProperty("t", step.isTied, nullptr);
+            if (step.offset != 0.0f) stepNode.setProperty("o", step.offset, nullptr);
+            if (step.ratchets != 1) stepNode.setProperty("r", step.ratchets, nullptr);
+            if (step.ratchetCurve != RatchetEven) stepNode.setProperty("rc", step.ratchetCurve, nullptr);
+            if (step.lanes[LaneCc] != LANE_OFF) stepNode.setProperty("cc", step.lanes[LaneCc], nullptr);
+            if (step.lanes[LaneBend] != LANE_OFF) stepNode.setProperty("pb", step.lanes[LaneBend], nullptr);
+            if (step.lanes[LanePressure] != LANE_OFF) stepNode.setProperty("at", step.lanes[LanePressure], nullptr);
             stepsTree.addChild(stepNode, -1, nullptr);
         }
         trackNode.addChild(stepsTree, -1, nullptr);
@@ -321,6 +540,21 @@ void StepSequencerAudioProcessor::getStateInformation (juce::MemoryBlock& destDa
         
     currentState.addChild(tracksTree, -1, nullptr);
     
+    // Song arrangement
+    while (currentState.getChildWithName("ARRANGEMENT").isValid()) {
+        currentState.removeChild(currentState.getChildWithName("ARRANGEMENT"), nullptr);
+    }
+    juce::ValueTree arrangementTree("ARRANGEMENT");
+    for (const auto& entry : snapshot.arrangement) {
+        juce::ValueTree entryNode("ENTRY");
+        entryNode.setProperty("p", entry.pattern, nullptr);
+        entryNode.setProperty("r", entry.repeats, nullptr);
+        entryNode.setProperty("t", entry.transpose, nullptr);
+        entryNode.setProperty("b", entry.startBar, nullptr);
+        arrangementTree.addChild(entryNode, -1, nullptr);
+    }
+    currentState.addChild(arrangementTree, -1, nullptr);
+    
     std::unique_ptr<juce::XmlElement> xml (currentState.createXml());
     
     copyXmlToBinary (*xml, destData);
@@ -330,31 +564,39 @@ void StepSequencerAudioProcessor::setStateInformation (const void* data, int siz
 {
     std::unique_ptr<juce::XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
     if (xmlState.get() != nullptr) {
+        bool legacyTiming = false;
         if (xmlState->hasTagName (apvts.state.getType())) {
             juce::ValueTree newState = juce::ValueTree::fromXml (*xmlState);
             apvts.replaceState (newState);
+            legacyTiming = !newState.getChildWithProperty("id", "steps").isValid(); // Saved before "steps" / "stepRate"
+            
+            // The tracks and arrangement are built here and only swapped in under the structure lock
+            SequencerEngine::Snapshot restored;
             
             // Restore Tracks
             juce::ValueTree tracksTree = newState.getChildWithName("TRACKS");
-            if (tracksTree.isValid()) {
-                int numTracksSaved = tracksTree.getNumChildren();
+            if (tracksTree.isValid() && tracksTree.getNumChildren() > 0) {
+                int numTracksSaved = juce::jmin(tracksTree.getNumChildren(), SequencerEngine::MAX_TRACKS);
                 
-                // Clear and resize to match saved state
-                tracks.clear();
-                trackRepeat.clear();
-                trackEnabled.clear();
-                tracks.resize((size_t)numTracksSaved);
-                trackRepeat.resize((size_t)numTracksSaved, 1);
-                trackEnabled.resize((size_t)numTracksSaved, true);
+                restored.tracks.resize((size_t)numTracksSaved);
+                restored.trackRepeat.resize((size_t)numTracksSaved, 1);
+                restored.trackRate.resize((size_t)numTracksSaved, -1);
+                restored.trackLength.resize((size_t)numTracksSaved, 0);
+                restored.trackChannel.resize((size_t)numTracksSaved, 1);
+                restored.trackBaseNote.resize((size_t)numTracksSaved, 60);
                 
                 for (int t = 0; t < numTracksSaved; ++t) {
                     juce::ValueTree trackNode = tracksTree.getChild(t);
-                    trackRepeat[(size_t)t] = (int)trackNode.getProperty("repeat", 1);
-                    trackEnabled[(size_t)t] = (bool)trackNode.getProperty("enabled", true);
+                    restored.trackRepeat[(size_t)t] = (int)trackNode.getProperty("repeat", 1);
+                    restored.trackEnabled.set(t, (bool)trackNode.getProperty("enabled", true));
+                    restored.trackRate[(size_t)t] = juce::jlimit(-1, NUM_RATES - 1, (int)trackNode.getProperty("rate", -1));
+                    restored.trackLength[(size_t)t] = juce::jlimit(0, MAX_STEPS, (int)trackNode.getProperty("patternLength", 0));
+                    restored.trackChannel[(size_t)t] = juce::jlimit(1, 16, (int)trackNode.getProperty("channel", 1));
+                    restored.trackBaseNote[(size_t)t] = juce::jlimit(0, 127, (int)trackNode.getProperty("baseNote", 60));
                     
-                    // Initialize steps default
-                    tracks[(size_t)t].resize(32);
-                     for (auto& s : tracks[(size_t)t]) { s.active = false; s.isTied = false; s.note = 60; s.velocity = 100; s.prob = 1.0f; }
+                    // Initialize steps default (older states have no length and always 32 steps)
+                    int length = juce::jlimit(1, MAX_STEPS, (int)trackNode.getProperty("length", DEFAULT_TRACK_LENGTH));
+                    SharedPattern::Steps trackSteps((size_t)length, makeEmptyStep());
 
                     juce::ValueTree stepsTree = trackNode.getChildWithName("STEPS");
                     
@@ -364,22 +606,52 @@ void StepSequencerAudioProcessor::setStateInformation (const void* data, int siz
                         bool active = (bool)stepNode.getProperty("a", false);
                         int note = (int)stepNode.getProperty("n", 60);
                         
-                        if (idx >= 0 && idx < (int)tracks[(size_t)t].size()) {
-                            tracks[(size_t)t][(size_t)idx].note = note;
-                            tracks[(size_t)t][(size_t)idx].velocity = (int)stepNode.getProperty("v", 100);
-                            tracks[(size_t)t][(size_t)idx].gate = (float)stepNode.getProperty("g", 0.5f);
-                            tracks[(size_t)t][(size_t)idx].prob = (float)stepNode.getProperty("p", 1.0f);
-                            tracks[(size_t)t][(size_t)idx].active = active;
-                            tracks[(size_t)t][(size_t)idx].isTied = (bool)stepNode.getProperty("t", false);
+                        if (idx >= 0 && idx < MAX_STEPS) {
+                            ensureTrackLength(trackSteps, idx + 1);
+                            auto& step = trackSteps[(size_t)idx];
+                            step.note = note;
+                            step.velocity = (int)stepNode.getProperty("v", 100);
+                            step.gate = (float)stepNode.getProperty("g", 0.5f);
+                            step.prob = (float)stepNode.getProperty("p", 1.0f);
+                            step.active = active;
+                            step.isTied = (bool)stepNode.getProperty("t", false);
+                            step.offset = juce::jlimit(-MAX_STEP_OFFSET, MAX_STEP_OFFSET, (float)stepNode.getProperty("o", 0.0f));
+                            step.ratchets = juce::jlimit(1, MAX_RATCHETS, (int)stepNode.getProperty("r", 1));
+                            step.ratchetCurve = juce::jlimit(0, NUM_RATCHET_CURVES - 1, (int)stepNode.getProperty("rc", 0));
+                            auto& lanes = step.lanes;
+                            lanes[LaneCc] = juce::jlimit(LANE_OFF, getLaneMaximum(LaneCc), (int)stepNode.getProperty("cc", LANE_OFF));
+                            lanes[LaneBend] = juce::jlimit(LANE_OFF, getLaneMaximum(LaneBend), (int)stepNode.getProperty("pb", LANE_OFF));
+                            lanes[LanePressure] = juce::jlimit(LANE_OFF, getLaneMaximum(LanePressure), (int)stepNode.getProperty("at", LANE_OFF));
                         }
                     }
+                    
+                    // Identical patterns already loaded (here or in another instance) are shared
+                    restored.tracks[(size_t)t] = PatternStore::getInstance().intern(std::move(trackSteps));
                 }
-                
-                // Reset pointers
-                currentTrack = 0;
-                if (!tracks.empty()) steps = &tracks[0];
             }
+            
+            // Restore song arrangement (sorted by start bar on restore)
+            juce::ValueTree arrangementTree = newState.getChildWithName("ARRANGEMENT");
+            for (int e = 0; e < arrangementTree.getNumChildren(); ++e) {
+                juce::ValueTree entryNode = arrangementTree.getChild(e);
+                SequencerEngine::ArrangementEntry entry;
+                entry.pattern = juce::jmax(0, (int)entryNode.getProperty("p", 0));
+                entry.repeats = juce::jmax(1, (int)entryNode.getProperty("r", 1));
+                entry.transpose = (int)entryNode.getProperty("t", 0);
+                entry.startBar = juce::jmax(0, (int)entryNode.getProperty("b", 0));
+                restored.arrangement.push_back(entry);
+            }
+            
+            engine.restoreSnapshot(std::move(restored));
+        }
+        // Older states carry the global timing in "numSteps" / "rate" only
+        if (legacyTiming) {
+            copyParameterValue("numSteps", "steps");
+            copyParameterValue("rate", "stepRate");
         }
+        globalNumSteps.reset();
+        globalRate.reset();
+        updateGlobalTiming(); // Restored "steps" / "stepRate"
     }
     
     // Notify editor to rebuild UI if it exists
@@ -394,264 +666,12 @@ void StepSequencerAudioProcessor::setStateInformation (const void* data, int siz
 //==============================================================================
 void StepSequencerAudioProcessor::randomizePattern(float amount)
 {
-    if (amount <= 0.0f) return;
-    
-    int rootNote = (int)*apvts.getRawParameterValue("key");
-    int scaleType = (int)*apvts.getRawParameterValue("scale");
-    
-    auto& random = juce::Random::getSystemRandom();
-    for (auto& s : *steps) {
-        // Randomize: Chaos generator - completely replaces values
-        if (random.nextFloat() < amount) {
-            // Structural changes
-            s.active = random.nextFloat() > 0.3f; // 70% chance to be active
-            
-            // Note changes (Total replacement)
-            s.note = getRandomNoteInScale(rootNote, scaleType, 3, 5); // C3-C5
-            
-            // Timbre changes (Total replacement)
-            s.velocity = random.nextInt(60) + 60; // 60-119 range
-            s.gate = 0.2f + (random.nextFloat() * 0.8f);
-            s.prob = 0.7f + (random.nextFloat() * 0.3f);
-            
-            // Clear ties usually in randomization to avoid broken chains
-            s.isTied = false;
-        }
-    }
-    
-    // Safety pass for ties? 
-    // Ideally we should validate ties, but for now simple random is fine.
+    engine.randomizePattern(amount, (int)*keyParam, (int)*scaleParam);
 }
 
 void StepSequencerAudioProcessor::mutatePattern(float amount)
 {
-    if (amount <= 0.0f) return;
-    
-    int rootNote = (int)*apvts.getRawParameterValue("key");
-    int scaleType = (int)*apvts.getRawParameterValue("scale");
-    
-    auto& random = juce::Random::getSystemRandom();
-    for (auto& s : *steps) {
-        // Mutate: Evolution - Shifts existing values slightly
-        // Apply to ACTIVE steps mostly to preserve structure
-        if (s.active && random.nextFloat() < amount) {
-            int type = random.nextInt(4);
-            
-            if (type == 0) {
-                // Pitch Shift (Small Interval)
-                // Find index in scale and move +/- 1 or 2
-                // Simplified: just try to find nearby scale note
-                int offset = random.nextBool() ? 1 : -1;
-                if (random.nextFloat() > 0.7f) offset *= 2; // Occasional larger jump
-                
-                // We don't have a "getIndexOfNote" easily, so just brute force search nearby
-                int tries = 0;
-                int candidate = s.note + offset;
-                while (!isNoteInScale(candidate, rootNote, scaleType) && tries < 5) {
-                    candidate += (offset > 0 ? 1 : -1);
-                    tries++;
-                }
-                if (isNoteInScale(candidate, rootNote, scaleType)) {
-                    s.note = juce::jlimit(0, 127, candidate);
-                }
-            }
-            else if (type == 1) {
-                // Velocity Nudge (+/- 15)
-                int diff = random.nextInt(30) - 15;
-                s.velocity = juce::jlimit(1, 127, s.velocity + diff);
-            }
-            else if (type == 2) {
-                // Gate Nudge (+/- 10%)
-                float diff = (random.nextFloat() * 0.2f) - 0.1f;
-                s.gate = juce::jlimit(0.1f, 1.0f, s.gate + diff);
-            }
-            else if (type == 3) {
-                 // Probability Nudge
-                 float diff = (random.nextFloat() * 0.2f) - 0.1f;
-                 s.prob = juce::jlimit(0.0f, 1.0f, s.prob + diff);
-            }
-        }
-        else if (!s.active && random.nextFloat() < (amount * 0.1f)) {
-             // Very rare chance to revive a dead step
-             s.active = true;
-             s.velocity = 80;
-        }
-    }
-}
-
-void StepSequencerAudioProcessor::switchToTrack(int trackIndex)
-{
-    if (trackIndex >= 0 && trackIndex < getNumTracks() && trackIndex != currentTrack) {
-        currentTrack = trackIndex;
-        steps = &tracks[currentTrack]; // Update pointer
-        currentStepIndex = 0; // Reset step position when switching tracks
-    }
-}
-
-void StepSequencerAudioProcessor::clearPattern()
-{
-    // Reset all steps in current track to default state
-    for (auto& s : *steps) {
-        s.active = false;
-        s.isTied = false;
-        s.note = 60;
-        s.velocity = 100;
-        s.gate = 0.5f;
-        s.prob = 1.0f;
-    }
-}
-
-void StepSequencerAudioProcessor::invertPattern()
-{
-    // Flip the active/inactive state of all steps
-    for (auto& s : *steps) {
-        s.active = !s.active;
-    }
-}
-
-void StepSequencerAudioProcessor::reversePattern()
-{
-    // Reverse the order of steps (only within the active numSteps range)
-    int numSteps = (int)*apvts.getRawParameterValue("numSteps");
-    if (numSteps > 0 && numSteps <= (int)steps->size()) {
-        std::reverse(steps->begin(), steps->begin() + numSteps);
-    }
-}
-
-void StepSequencerAudioProcessor::euclideanPattern(int hits, int steps)
-{
-    // Bjorklund algorithm for Euclidean rhythm generation
-    // Distribute 'hits' evenly across 'steps'
-    
-    if (hits <= 0 || steps <= 0 || hits > steps) return;
-    
-    // Clear pattern first
-    for (auto& s : *this->steps) {
-        s.active = false;
-        s.isTied = false;
-    }
-    
-    // Simple Euclidean distribution using Bresenham-like algorithm
-    int bucket = 0;
-    for (int i = 0; i < steps && i < (int)this->steps->size(); ++i) {
-        bucket += hits;
-        if (bucket >= steps) {
-            bucket -= steps;
-            (*this->steps)[i].active = true;
-        }
-    }
-}
-
-bool StepSequencerAudioProcessor::isNoteInScale(int midiNote, int rootNote, int scaleType)
-{
-    // Scale intervals (semitones from root)
-    static const int chromatic[] = {0,1,2,3,4,5,6,7,8,9,10,11};
-    static const int major[] = {0,2,4,5,7,9,11};
-    static const int minor[] = {0,2,3,5,7,8,10};
-    static const int dorian[] = {0,2,3,5,7,9,10};
-    static const int phrygian[] = {0,1,3,5,7,8,10};
-    static const int mixolydian[] = {0,2,4,5,7,9,10};
-    static const int pentatonic[] = {0,2,4,7,9};
-    
-    const int* intervals = nullptr;
-    int count = 0;
-    
-    switch(scaleType) {
-        case 0: intervals = chromatic; count = 12; break;
-        case 1: intervals = major; count = 7; break;
-        case 2: intervals = minor; count = 7; break;
-        case 3: intervals = dorian; count = 7; break;
-        case 4: intervals = phrygian; count = 7; break;
-        case 5: intervals = mixolydian; count = 7; break;
-        case 6: intervals = pentatonic; count = 5; break;
-        default: return true;
-    }
-    
-    int noteClass = midiNote % 12;
-    int offset = (noteClass - rootNote + 12) % 12;
-    
-    for (int i = 0; i < count; ++i) {
-        if (intervals[i] == offset) return true;
-    }
-    return false;
-}
-
-int StepSequencerAudioProcessor::getRandomNoteInScale(int rootNote, int scaleType, int minOctave, int maxOctave)
-{
-    // Scale intervals (semitones from root)
-    static const int chromatic[] = {0,1,2,3,4,5,6,7,8,9,10,11};
-    static const int major[] = {0,2,4,5,7,9,11};
-    static const int minor[] = {0,2,3,5,7,8,10};
-    static const int dorian[] = {0,2,3,5,7,9,10};
-    static const int phrygian[] = {0,1,3,5,7,8,10};
-    static const int mixolydian[] = {0,2,4,5,7,9,10};
-    static const int pentatonic[] = {0,2,4,7,9};
-    
-    const int* intervals = nullptr;
-    int count = 0;
-    
-    switch(scaleType) {
-        case 0: intervals = chromatic; count = 12; break;
-        case 1: intervals = major; count = 7; break;
-        case 2: intervals = minor; count = 7; break;
-        case 3: intervals = dorian; count = 7; break;
-        case 4: intervals = phrygian; count = 7; break;
-        case 5: intervals = mixolydian; count = 7; break;
-        case 6: intervals = pentatonic; count = 5; break;
-        default: intervals = chromatic; count = 12; break;
-    }
-    
-    auto& random = juce::Random::getSystemRandom();
-    
-    // Pick random octave in range
-    int octave = random.nextInt(juce::Range<int>(minOctave, maxOctave + 1));
-    
-    // Pick random scale degree
-    int degree = random.nextInt(count);
-    int interval = intervals[degree];
-    
-    // Calculate MIDI note: octave * 12 + root + interval
-    int midiNote = (octave * 12) + rootNote + interval;
-    
-    // Clamp to valid MIDI range
-    return juce::jlimit(0, 127, midiNote);
-}
-
-void StepSequencerAudioProcessor::addTrack()
-{
-    std::vector<Step> newTrack(32);
-    for (auto& s : newTrack) {
-        s.active = false;
-        s.note = 60;
-        s.velocity = 100;
-        s.gate = 0.5f;
-        s.prob = 1.0f;
-    }
-    tracks.push_back(newTrack);
-    trackRepeat.push_back(1);
-    trackEnabled.push_back(true);
-    
-    // Update steps pointer after reallocation
-    if (currentTrack < (int)tracks.size()) {
-        steps = &tracks[currentTrack];
-    }
-}
-
-void StepSequencerAudioProcessor::removeTrack()
-{
-    if (tracks.size() > 1) {
-        tracks.pop_back();
-        trackRepeat.pop_back();
-        trackEnabled.pop_back();
-        
-        // Make sure currentTrack is still valid
-        if (currentTrack >= (int)tracks.size()) {
-            currentTrack = (int)tracks.size() - 1;
-        }
-        
-        // Update steps pointer after removal
-        steps = &tracks[currentTrack];
-    }
+    engine.mutatePattern(amount, (int)*keyParam, (int)*scaleParam);
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -8,8 +8,15 @@
 #pragma once
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <vector>
+#include <array>
+#include <atomic>
+#include "Core/SequencerEngine.h"
+#include "Core/MidiClockFollower.h"
+#include "RealtimeGuard.h"
 
-class StepSequencerAudioProcessor : public juce::AudioProcessor
+// The plugin shell: parameters, state, host transport and MIDI I/O. Tracks, arrangement and
+// playback live in SequencerEngine (JUCE-free, Source/Core), which processBlock drives.
+class StepSequencerAudioProcessor : public juce::AudioProcessor, private juce::Timer
 {
 public:
     StepSequencerAudioProcessor();
@@ -18,6 +25,7 @@ public:
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
 
     juce::AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override;
@@ -45,65 +53,106 @@ public:
     // APVTS
     juce::AudioProcessorValueTreeState apvts;
     
-    // Data structures for UI
-    struct Step { 
-        bool active = true; 
-        bool isTied = false;
-        int note = 60; 
-        int velocity = 100; 
-        float gate = 0.5f; // 0.1 to ~0.9
-        float prob = 1.0f; 
+    // Per-step automation lanes: "laneSmooth" choices
+    static const juce::StringArray& getLaneResolutionNames();
+    
+    // Tempo-synced LFOs ("lfoNShape" / "lfoNRate" / "lfoNTarget" / "lfoNDepth"), sampled once
+    // per step at its onset from the host position - no per-sample work, pattern left untouched
+    static const juce::StringArray& getLfoRateNames();      // "4 Bars" .. "1/16"
+    static juce::String getLfoParamId(int lfoIndex, const char* name); // "lfo1Shape", ...
+    
+    // Tracks, arrangement and playback (the editor edits through it)
+    SequencerEngine engine;
+    
+    static const juce::StringArray& getRateNames();  // "1/4" .. "1/16." (matches the "stepRate" choices)
+    
+    // "syncSource" choices: host transport, or MIDI clock / Start / Stop / Continue / SPP on the input
+    enum SyncSource { SyncHost = 0, SyncMidiClock };
+    
+    // Per-block performance telemetry. The audio thread pushes one record per block into a
+    // lock-free single-producer / single-consumer FIFO; the editor drains it (the only reader).
+    struct BlockStats {
+        juce::int64 elapsedNs = 0;
+        int numSamples = 0;
+        double sampleRate = 44100.0;
+        int eventsEmitted = 0;          // MIDI events the engine sent (not host MIDI passed through)
+        int stepsCrossed = 0;           // Step decisions made
+        float maxOnsetError = 0.0f;     // Largest |sent - exact| event position, in samples
     };
+    int popBlockStats(BlockStats* dest, int maxCount); // Message thread
     
-    // Multi-track system (dynamic)
-    std::vector<std::vector<Step>> tracks; // Dynamic list of tracks
-    std::vector<int> trackRepeat; // How many times to repeat each track before moving to next
-    std::vector<bool> trackEnabled; // Which tracks are active
-    int currentTrack = 0;
-    std::vector<Step>* steps = nullptr; // Pointer to current track for easy switching
-    int currentStepIndex = 0;
-    bool isPlaying = false;
-    
-    // Helper to add/remove tracks
-    void addTrack();
-    void removeTrack();
-    int getNumTracks() const { return (int)tracks.size(); }
-    
-    // Time Signature from Host
-    int timeSignatureNumerator = 4;
-    int timeSignatureDenominator = 4;
-    
-    // Track switching
-    int barsPlayedOnCurrentTrack = 0;
-    int beatsPlayedInCurrentBar = 0;
-    
-    // Generative Functions
+    // Generators that follow the "key" / "scale" parameters (current track)
     void randomizePattern(float amount = 1.0f); // amount: 0.0 to 1.0
     void mutatePattern(float amount = 0.2f);    // amount: 0.0 to 1.0
-    void clearPattern();                        // Reset all steps to default
-    void invertPattern();                       // Flip active/inactive states
-    void reversePattern();                      // Reverse step order
-    void euclideanPattern(int hits, int steps); // Euclidean rhythm generator
-    void switchToTrack(int trackIndex);
-    
-    // Helper Functions
-    bool isNoteInScale(int midiNote, int rootNote, int scaleType);
-    int getRandomNoteInScale(int rootNote, int scaleType, int minOctave, int maxOctave);
 
 private:
     static juce::AudioProcessorValueTreeState::ParameterLayout createParams();
     
-    // Timing state
+    // Raw parameter values (no string lookups on the audio thread)
+    std::atomic<float>* inputApplyParam = nullptr;
+    std::atomic<float>* inputHoldParam = nullptr;
+    std::atomic<float>* inputModeParam = nullptr;
+    std::atomic<float>* keyParam = nullptr;
+    std::atomic<float>* laneCcParam = nullptr;
+    std::atomic<float>* laneSmoothParam = nullptr;
+    std::atomic<float>* legacyNumStepsParam = nullptr;
+    std::atomic<float>* legacyRateParam = nullptr;
+    std::atomic<float>* numStepsParam = nullptr;
+    std::atomic<float>* octaveParam = nullptr;
+    std::atomic<float>* playModeParam = nullptr;
+    std::atomic<float>* rateParam = nullptr;
+    std::atomic<float>* recordModeParam = nullptr;
+    std::atomic<float>* scaleParam = nullptr;
+    std::atomic<float>* syncSourceParam = nullptr;
+    std::atomic<float>* voiceLimitParam = nullptr;
+    std::atomic<float>* voiceStealParam = nullptr;
+    
+    SequencerEngine::Settings readSettings() const;
+    void updateGlobalTiming();           // "steps" / "stepRate" (or their legacy versions) into the engine
+    void copyParameterValue(const char* fromId, const char* toId);
+
+    // Whichever of a legacy parameter and its replacement changed last (-1: not seen yet)
+    struct LatestOf
+    {
+        std::atomic<int> lastLegacy { -1 };
+        std::atomic<int> lastCurrent { -1 };
+        std::atomic<int> value { 0 };
+        int update(int legacy, int current);
+        void reset();                    // Next update takes the current parameter
+    };
+    LatestOf globalNumSteps, globalRate;
+    
     double sampleRate = 44100.0;
-    double currentBPM = 120.0;
-    double samplesPerBeat = 22050.0;
     
-    // Phasor / Accumulator concept (simplified for reliability)
-    double accumulatedSamples = 0.0;
+    // MIDI clock sync: the follower turns clock on the input into position and tempo; each block
+    // starts where the last one ended and its tempo is steered onto the loop's position
+    MidiClockFollower clockFollower;
+    double clockSamplePosition = 0.0;    // Samples processed, the follower's time base
+    double clockBlockEndPpq = 0.0;
+    int clockEpoch = 0;
+    bool readMidiClock(const juce::MidiBuffer& midi, int numSamples, double& blockStartPpq, double& bpm, int& stopOffset);
+    static bool isClockMessage(const juce::MidiMessage& message);
+    void readTransport(const juce::MidiBuffer& midi, int numSamples, SequencerEngine::Transport& transport);
+    
+    // MIDI input for the engine: short messages in time order; SysEx stays in the host buffer
+    std::vector<MidiEvent> inputEvents;
+    juce::MidiBuffer hostPassThrough;
+    int numInputEvents = 0;
+    void takeInputMidi(juce::MidiBuffer& hostMidi, bool clockSync);
+    
+    // The engine's output is copied to the host buffer once per block
+    int midiOutReserveBytes = 0;
+    void copyToHost(SequencerEngine::EventSpan events, juce::MidiBuffer& hostMidi) const;
+    static void addOverflowEvent(void* hostMidi, const std::uint8_t* data, int numBytes, int sampleOffset);
+    
+    void timerCallback() override;           // Applies recorded steps
+    
+    static const int TELEMETRY_FIFO_SIZE = 1024; // ~10 s of 512-sample blocks at 48 kHz
+    juce::AbstractFifo telemetryFifo { TELEMETRY_FIFO_SIZE };
+    std::array<BlockStats, TELEMETRY_FIFO_SIZE> telemetryBuffer;
     
-    // Note State
-    int lastNote = -1;
-    long samplesRemainingForGate = 0;
+    struct LfoParameters { std::atomic<float>* shape; std::atomic<float>* rate; std::atomic<float>* target; std::atomic<float>* depth; };
+    std::array<LfoParameters, SequencerCore::NUM_LFOS> lfoParameters {}; // Looked up once - no string ids on the audio thread
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StepSequencerAudioProcessor)
 };
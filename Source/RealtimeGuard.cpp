@@ -0,0 +1,287 @@
+/*
+  ==============================================================================
+    RealtimeGuard.cpp
+    Debug check for allocations, locks, file I/O and sleeps on the audio thread
+  ==============================================================================
+*/
+
+#include "RealtimeGuard.h"
+
+#if STEPSEQ_RT_GUARD
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if ! JUCE_WINDOWS
+ #include <cstdarg>
+ #include <dlfcn.h>
+ #include <fcntl.h>
+ #include <pthread.h>
+ #include <time.h>
+ #include <unistd.h>
+#endif
+
+// The flags are read inside malloc: keep their TLS access from allocating on first use
+// when the plugin is dlopen'd
+#if JUCE_GCC || JUCE_CLANG
+ #define STEPSEQ_GUARD_TLS __attribute__ ((tls_model ("initial-exec")))
+#else
+ #define STEPSEQ_GUARD_TLS
+#endif
+
+namespace
+{
+    STEPSEQ_GUARD_TLS thread_local bool inRealtimeSection = false;
+    STEPSEQ_GUARD_TLS thread_local bool reporting = false;
+    std::atomic<RealtimeGuard::ViolationHandler> violationHandler { nullptr };
+
+   #if ! JUCE_WINDOWS
+    // The next definition of an interposed function - libc's
+    template <typename Fn>
+    Fn findNext (const char* name)
+    {
+        return reinterpret_cast<Fn> (dlsym (RTLD_NEXT, name));
+    }
+
+    //==============================================================================
+    // libc's allocators, looked up once. dlsym can allocate while they are being looked
+    // up: those few blocks come from a static arena and are never given back.
+    struct Allocators
+    {
+        void* (*malloc) (size_t);
+        void* (*calloc) (size_t, size_t);
+        void* (*realloc) (void*, size_t);
+        int (*posixMemalign) (void**, size_t, size_t);
+        void (*free) (void*);
+    };
+
+    STEPSEQ_GUARD_TLS thread_local bool resolvingAllocators = false;
+
+    alignas (std::max_align_t) unsigned char bootstrapArena[4096];
+    std::atomic<size_t> bootstrapUsed { 0 };
+
+    void* bootstrapAllocate (size_t size)
+    {
+        const size_t aligned = (size + alignof (std::max_align_t) - 1) & ~(alignof (std::max_align_t) - 1);
+        const size_t offset = bootstrapUsed.fetch_add (aligned);
+        return offset + aligned <= sizeof (bootstrapArena) ? bootstrapArena + offset : nullptr;
+    }
+
+    bool isBootstrapBlock (const void* p)
+    {
+        auto* bytes = static_cast<const unsigned char*> (p);
+        return bytes >= bootstrapArena && bytes < bootstrapArena + sizeof (bootstrapArena);
+    }
+
+    const Allocators& getAllocators()
+    {
+        static const Allocators allocators = []
+        {
+            resolvingAllocators = true;
+            const Allocators found { findNext<void* (*) (size_t)> ("malloc"),
+                                     findNext<void* (*) (size_t, size_t)> ("calloc"),
+                                     findNext<void* (*) (void*, size_t)> ("realloc"),
+                                     findNext<int (*) (void**, size_t, size_t)> ("posix_memalign"),
+                                     findNext<void (*) (void*)> ("free") };
+            resolvingAllocators = false;
+            return found;
+        }();
+
+        return allocators;
+    }
+
+    // operator new has already been checked: skip the malloc() check so it reports once
+    void* allocateUnchecked (size_t size)    { return getAllocators().malloc (size); }
+   #else
+    void* allocateUnchecked (size_t size)    { return std::malloc (size); }
+   #endif
+}
+
+bool RealtimeGuard::isInRealtimeSection()          { return inRealtimeSection; }
+void RealtimeGuard::setInRealtimeSection(bool in)  { inRealtimeSection = in; }
+void RealtimeGuard::setViolationHandler(ViolationHandler handler) { violationHandler = handler; }
+
+void RealtimeGuard::reportViolation(const char* what)
+{
+    if (reporting) return;
+
+    // Reporting allocates, locks and writes itself - leave the section while it runs
+    reporting = true;
+    const bool wasInSection = inRealtimeSection;
+    inRealtimeSection = false;
+
+    if (auto handler = violationHandler.load()) {
+        handler (what);
+    }
+    else {
+        juce::Logger::outputDebugString(juce::String("Audio thread ") + what + " in processBlock:\n"
+                                        + juce::SystemStats::getStackBacktrace());
+        jassertfalse;
+    }
+
+    inRealtimeSection = wasInSection;
+    reporting = false;
+}
+
+//==============================================================================
+// Global allocation functions: every new / delete in the plugin comes through here
+void* operator new (std::size_t size)
+{
+    if (inRealtimeSection) RealtimeGuard::reportViolation("heap allocation");
+    if (void* p = allocateUnchecked (size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t size)
+{
+    if (inRealtimeSection) RealtimeGuard::reportViolation("heap allocation");
+    if (void* p = allocateUnchecked (size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+    if (inRealtimeSection) RealtimeGuard::reportViolation("heap allocation");
+    return allocateUnchecked (size == 0 ? 1 : size);
+}
+
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept
+{
+    if (inRealtimeSection) RealtimeGuard::reportViolation("heap allocation");
+    return allocateUnchecked (size == 0 ? 1 : size);
+}
+
+void operator delete (void* p) noexcept                                 { std::free(p); }
+void operator delete[] (void* p) noexcept                               { std::free(p); }
+void operator delete (void* p, std::size_t) noexcept                    { std::free(p); }
+void operator delete[] (void* p, std::size_t) noexcept                  { std::free(p); }
+void operator delete (void* p, const std::nothrow_t&) noexcept          { std::free(p); }
+void operator delete[] (void* p, const std::nothrow_t&) noexcept        { std::free(p); }
+
+//==============================================================================
+// The C allocation functions (POSIX): HeapBlock, juce::String's buffers and C libraries
+// allocate through these rather than through operator new
+#if ! JUCE_WINDOWS
+extern "C" void* malloc (size_t size)
+{
+    if (resolvingAllocators) return bootstrapAllocate (size);
+
+    if (inRealtimeSection) RealtimeGuard::reportViolation("malloc()");
+    return getAllocators().malloc (size);
+}
+
+extern "C" void* calloc (size_t count, size_t size)
+{
+    if (resolvingAllocators) {
+        // The arena is static, so already zeroed
+        return size != 0 && count > sizeof (bootstrapArena) / size ? nullptr : bootstrapAllocate (count * size);
+    }
+
+    if (inRealtimeSection) RealtimeGuard::reportViolation("calloc()");
+    return getAllocators().calloc (count, size);
+}
+
+extern "C" void* realloc (void* p, size_t size)
+{
+    if (resolvingAllocators) return bootstrapAllocate (size);
+
+    if (inRealtimeSection) RealtimeGuard::reportViolation("realloc()");
+
+    // A bootstrap block's size isn't kept: copy all it could hold and let libc take over
+    if (p != nullptr && isBootstrapBlock (p)) {
+        void* moved = getAllocators().malloc (size);
+        if (moved != nullptr) {
+            const auto available = (size_t) (bootstrapArena + sizeof (bootstrapArena) - static_cast<unsigned char*> (p));
+            std::memcpy (moved, p, size < available ? size : available);
+        }
+        return moved;
+    }
+
+    return getAllocators().realloc (p, size);
+}
+
+extern "C" int posix_memalign (void** result, size_t alignment, size_t size)
+{
+    if (inRealtimeSection) RealtimeGuard::reportViolation("posix_memalign()");
+    return getAllocators().posixMemalign (result, alignment, size);
+}
+
+extern "C" void free (void* p)
+{
+    if (p == nullptr || isBootstrapBlock (p)) return;
+    getAllocators().free (p);
+}
+
+//==============================================================================
+// Mutex locks (POSIX): forwarded to the real implementation after the check. Catches
+// CriticalSection / std::mutex and anything else built on pthread mutexes.
+extern "C" int pthread_mutex_lock (pthread_mutex_t* mutex)
+{
+    static const auto realLock = findNext<int (*) (pthread_mutex_t*)> ("pthread_mutex_lock");
+
+    if (inRealtimeSection) RealtimeGuard::reportViolation("mutex lock");
+    return realLock (mutex);
+}
+
+//==============================================================================
+// System calls that can block on the disk or the scheduler: file I/O (logging, File,
+// FileOutputStream) and sleeps (Thread::sleep, std::this_thread::sleep_for)
+extern "C" ssize_t write (int fd, const void* buffer, size_t size)
+{
+    static const auto realWrite = findNext<ssize_t (*) (int, const void*, size_t)> ("write");
+
+    if (inRealtimeSection) RealtimeGuard::reportViolation("write()");
+    return realWrite (fd, buffer, size);
+}
+
+extern "C" ssize_t read (int fd, void* buffer, size_t size)
+{
+    static const auto realRead = findNext<ssize_t (*) (int, void*, size_t)> ("read");
+
+    if (inRealtimeSection) RealtimeGuard::reportViolation("read()");
+    return realRead (fd, buffer, size);
+}
+
+extern "C" int open (const char* path, int flags, ...)
+{
+    static const auto realOpen = findNext<int (*) (const char*, int, ...)> ("open");
+
+    // The mode is only passed when a file may be created
+    mode_t mode = 0;
+   #ifdef O_TMPFILE
+    const bool hasMode = (flags & O_CREAT) != 0 || (flags & O_TMPFILE) == O_TMPFILE;
+   #else
+    const bool hasMode = (flags & O_CREAT) != 0;
+   #endif
+    if (hasMode) {
+        va_list args;
+        va_start (args, flags);
+        mode = (mode_t) va_arg (args, int);
+        va_end (args);
+    }
+
+    if (inRealtimeSection) RealtimeGuard::reportViolation("open()");
+    return realOpen (path, flags, mode);
+}
+
+extern "C" int usleep (useconds_t microseconds)
+{
+    static const auto realUsleep = findNext<int (*) (useconds_t)> ("usleep");
+
+    if (inRealtimeSection) RealtimeGuard::reportViolation("usleep()");
+    return realUsleep (microseconds);
+}
+
+extern "C" int nanosleep (const struct timespec* duration, struct timespec* remaining)
+{
+    static const auto realNanosleep = findNext<int (*) (const struct timespec*, struct timespec*)> ("nanosleep");
+
+    if (inRealtimeSection) RealtimeGuard::reportViolation("nanosleep()");
+    return realNanosleep (duration, remaining);
+}
+#endif
+
+#endif
@@ -0,0 +1,47 @@
+/*
+  ==============================================================================
+    RealtimeGuard.h
+    Debug check for allocations, locks, file I/O and sleeps on the audio thread
+  ==============================================================================
+*/
+
+#pragma once
+
+// Build with STEPSEQ_RT_GUARD=1 (CMake option STEPSEQ_RT_GUARD, debug builds) and every heap
+// allocation (operator new, malloc / calloc / realloc / posix_memalign), mutex lock, file
+// read / write / open or sleep made inside a ScopedRealtimeSection - processBlock - prints a
+// stack trace and hits a jassert. Anything that can stall the audio thread shows up in testing,
+// not as a dropout on a user's machine. Without the flag this compiles to nothing.
+//
+// The checks replace operator new and interpose the C allocators and POSIX calls (forwarding
+// through dlsym(RTLD_NEXT)), so they only see calls made from the plugin's own code, JUCE
+// included - not ones made inside libc or the host. A plugin is dlopen'd, and the host's libc /
+// libstdc++ come first in symbol lookup: on Linux the plugin is linked with -Bsymbolic-functions
+// in guard builds so its own calls bind to these definitions (StepSequencerGuardTest checks
+// exactly that). On Windows only the operator new check is built; macOS is expected to behave
+// like Linux (calls bind within the image) but is untested.
+#ifndef STEPSEQ_RT_GUARD
+ #define STEPSEQ_RT_GUARD 0
+#endif
+
+namespace RealtimeGuard
+{
+   #if STEPSEQ_RT_GUARD
+    bool isInRealtimeSection();
+    void setInRealtimeSection(bool inSection);
+    void reportViolation(const char* what);  // Stack trace + jassert (outside the section while reporting)
+
+    // Replaces the stack trace + jassert (tests count violations instead); nullptr restores it
+    using ViolationHandler = void (*) (const char* what);
+    void setViolationHandler(ViolationHandler handler);
+
+    struct ScopedRealtimeSection
+    {
+        ScopedRealtimeSection() : wasInSection(isInRealtimeSection()) { setInRealtimeSection(true); }
+        ~ScopedRealtimeSection() { setInRealtimeSection(wasInSection); }
+        const bool wasInSection;
+    };
+   #else
+    struct ScopedRealtimeSection { ScopedRealtimeSection() {} }; // User-provided: no unused-variable warning
+   #endif
+}
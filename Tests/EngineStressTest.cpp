@@ -0,0 +1,149 @@
+/*
+  ==============================================================================
+    EngineStressTest.cpp
+    The audio thread against editor edits (ctest: StepSequencerStressTest)
+
+    One thread plays blocks the way processBlock does - settings, then process()
+    with the host position, looping every few bars - while another makes the
+    editor's structural edits as fast as it can. Build with
+    -DSTEPSEQ_SANITIZE=thread (or address) to check the locking; the test itself
+    checks that every note-on gets exactly one note-off and nothing is left held.
+  ==============================================================================
+*/
+
+#include "SequencerEngine.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+namespace
+{
+    struct NoteLedger
+    {
+        int held[16][128] = {};
+        int noteOns = 0;
+        int strayNoteOffs = 0;
+
+        void add(const MidiEvent& e)
+        {
+            const int status = e.bytes[0] & 0xf0;
+            const int channel = e.bytes[0] & 0x0f;
+            if (status == 0x90 && e.bytes[2] > 0) {
+                held[channel][e.bytes[1]]++;
+                noteOns++;
+            }
+            else if (status == 0x80 || status == 0x90) {
+                if (held[channel][e.bytes[1]] == 0) strayNoteOffs++;
+                else held[channel][e.bytes[1]]--;
+            }
+        }
+
+        int stillHeld() const
+        {
+            int n = 0;
+            for (auto& channel : held)
+                for (int count : channel) n += count;
+            return n;
+        }
+    };
+
+    SharedPattern makeBusyPattern(int length, int seed)
+    {
+        SharedPattern::Steps steps((size_t)length, SequencerCore::makeEmptyStep());
+        for (int i = 0; i < length; ++i) {
+            auto& s = steps[(size_t)i];
+            s.active = (i + seed) % 3 != 0;
+            s.note = 48 + (i * 7 + seed) % 24;
+            s.gate = 0.25f + (float)((i + seed) % 8) * 0.5f; // Some notes ring across several steps
+            s.ratchets = 1 + (i + seed) % 3;
+            s.offset = (float)((i + seed) % 5 - 2) * 0.2f;
+        }
+        return SharedPattern(std::move(steps));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const double seconds = argc > 1 ? std::atof(argv[1]) : 3.0;
+    const double sampleRate = 48000.0;
+    const int blockSize = 256;
+
+    SequencerEngine engine;
+    engine.prepare(sampleRate, blockSize);
+    engine.setGlobalNumSteps(16);
+    engine.setGlobalRate(3); // 1/32: lots of decisions per block
+    for (int t = 0; t < 8; ++t) {
+        if (t > 0) engine.addTrack();
+        engine.setPattern(t, makeBusyPattern(16, t));
+        engine.setTrackChannel(t, 1 + t % 2); // Tracks share channels and notes
+        engine.appendToArrangement(t, 1);
+    }
+
+    std::atomic<bool> running { true };
+    NoteLedger ledger;
+    long long blocks = 0;
+
+    std::thread audio ([&] {
+        SequencerEngine::Settings settings;
+        settings.playMode = SequencerEngine::PlayModeLayer;
+        settings.voiceLimit = 4; // Voice stealing too
+        double ppq = 0.0;
+
+        while (running) {
+            SequencerEngine::Transport transport;
+            transport.isPlaying = true;
+            transport.hasPosition = true;
+            transport.ppq = ppq;
+            transport.bpm = 140.0;
+
+            engine.setSettings(settings);
+            for (const auto& e : engine.process(blockSize, transport)) ledger.add(e);
+
+            ppq += transport.bpm / 60.0 * blockSize / sampleRate;
+            if (ppq >= 8.0) ppq = 0.0; // Host loop
+            if (++blocks % 500 == 0) settings.playMode = (settings.playMode + 1) % 3; // Chain, song, layer
+        }
+
+        SequencerEngine::Transport stopped;
+        for (const auto& e : engine.process(blockSize, stopped)) ledger.add(e);
+    });
+
+    // The editor: structural edits back to back, plus state saves and restores (as the
+    // processor makes them) of an earlier snapshot
+    SequencerEngine::Snapshot saved = engine.takeSnapshot();
+    const auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+    for (int i = 0; std::chrono::steady_clock::now() < end; ++i) {
+        switch (i % 15) {
+            case 0: engine.addTrack(); break;
+            case 1: engine.duplicateTrack(i % engine.getNumTracks()); break;
+            case 2: engine.removeTrack(); break;
+            case 3: engine.removeTrack(); break;
+            case 4: engine.setTrackRate(i % engine.getNumTracks(), i % 5 - 1); break;
+            case 5: engine.setTrackLength(i % engine.getNumTracks(), i % 24); break;
+            case 6: engine.setPattern(i % engine.getNumTracks(), makeBusyPattern(8 + i % 24, i)); break;
+            case 7: engine.setTrackEnabled(i % engine.getNumTracks(), i % 4 != 0); break;
+            case 8: engine.setArrangementTranspose(i % 8, i % 7 - 3); break;
+            case 9: engine.setArrangementRepeats(i % 8, 1 + i % 3); break;
+            case 10:
+                engine.editStep(i % 40, [i](SequencerEngine::Step& step) { // Grows the track past 32 steps too
+                    step.active = i % 3 != 0;
+                    step.ratchets = 1 + i % 4;
+                });
+                break;
+            case 11: engine.randomizePattern(0.7f, i % 12, i % 3); break;
+            case 12: if (i % 4 == 0) saved = engine.takeSnapshot(); break;
+            case 13: engine.restoreSnapshot(saved); break;
+            default: engine.switchToTrack(i % engine.getNumTracks()); break;
+        }
+        if (engine.getNumTracks() < 2) engine.addTrack();
+    }
+
+    running = false;
+    audio.join();
+
+    std::printf("%lld blocks, %d note-ons, %d stray note-offs, %d notes left held\n",
+                blocks, ledger.noteOns, ledger.strayNoteOffs, ledger.stillHeld());
+    return ledger.noteOns > 0 && ledger.strayNoteOffs == 0 && ledger.stillHeld() == 0 ? 0 : 1;
+}
@@ -0,0 +1,306 @@
+/*
+  ==============================================================================
+    PluginTimingTest.cpp
+    Note timing through the plugin's processBlock (ctest: StepSequencerTimingTest)
+
+    A scripted host play head drives StepSequencerAudioProcessor block by block:
+    tempo jumps, relocations, stop / start, at block sizes 1, 7, 511 and 4096.
+    Every note-on and note-off the plugin sends is compared with the grid worked
+    out from the script - step n at n * step length, odd steps swung late - so
+    any drift, double trigger or missing note-off fails the test.
+  ==============================================================================
+*/
+
+#include "../Source/PluginProcessor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+    struct ScriptBlock
+    {
+        long long startSample = 0;
+        int numSamples = 0;
+        bool isPlaying = false;
+        double ppq = 0.0;
+        double bpm = 120.0;
+    };
+
+    // What the host does, one block at a time
+    struct Script
+    {
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+        std::vector<ScriptBlock> blocks;
+        double ppq = 0.0;
+        double bpm = 120.0;
+        long long sample = 0;
+
+        double quartersPerSample() const { return bpm / (60.0 * sampleRate); }
+
+        void play(double quarters)
+        {
+            const double end = ppq + quarters;
+            while (ppq < end) {
+                blocks.push_back({ sample, blockSize, true, ppq, bpm });
+                ppq += quartersPerSample() * blockSize;
+                sample += blockSize;
+            }
+        }
+
+        void stop(int numBlocks)
+        {
+            for (int i = 0; i < numBlocks; ++i) {
+                blocks.push_back({ sample, blockSize, false, ppq, bpm });
+                sample += blockSize;
+            }
+        }
+
+        void setTempo(double newBpm) { bpm = newBpm; }
+        void relocate(double newPpq) { ppq = newPpq; }
+    };
+
+    class ScriptedPlayHead : public juce::AudioPlayHead
+    {
+    public:
+        const ScriptBlock* block = nullptr;
+
+        juce::Optional<PositionInfo> getPosition() const override
+        {
+            PositionInfo info;
+            info.setIsPlaying(block->isPlaying);
+            info.setBpm(block->bpm);
+            info.setPpqPosition(block->ppq);
+            info.setTimeSignature(TimeSignature { 4, 4 });
+            info.setTimeInSamples(block->startSample);
+            return info;
+        }
+    };
+
+    struct NoteEvent
+    {
+        long long sample = 0;
+        bool isNoteOn = false;
+        bool operator< (const NoteEvent& other) const
+        {
+            return sample != other.sample ? sample < other.sample : isNoteOn < other.isNoteOn; // Offs first
+        }
+        bool operator== (const NoteEvent& other) const { return sample == other.sample && isNoteOn == other.isNoteOn; }
+    };
+
+    struct Case
+    {
+        int rate = 2;           // "stepRate" choice
+        int numSteps = 16;
+        float swing = 0.0f;     // Odd steps late, in steps (0 - 0.5)
+        float gate = 0.5f;
+        bool legacy = false;    // Set through "numSteps" / "rate" after "steps" / "stepRate" (old automation)
+    };
+
+    //==============================================================================
+    // The sample the scheduler must send 'ppq' on: the first sample at or after it
+    long long sampleOf(const Script& script, size_t first, size_t last, double ppq)
+    {
+        for (size_t b = first; b <= last; ++b) {
+            const auto& block = script.blocks[b];
+            const double exact = (ppq - block.ppq) / (block.bpm / (60.0 * script.sampleRate));
+            const double offset = std::max(0.0, std::ceil(exact - 1.0e-6));
+            if (offset < block.numSamples) return block.startSample + (long long)offset;
+        }
+        const auto& end = script.blocks[last];
+        return end.startSample + end.numSamples;
+    }
+
+    std::vector<NoteEvent> expectedNotes(const Script& script, const Case& c)
+    {
+        std::vector<NoteEvent> notes;
+        const double stepQuarters = SequencerCore::getRateQuarters(c.rate);
+
+        // Runs of playing blocks the host plays straight through; a relocation or stop ends one
+        for (size_t first = 0; first < script.blocks.size();) {
+            if (!script.blocks[first].isPlaying) { ++first; continue; }
+
+            size_t last = first;
+            auto endOf = [&](size_t b) {
+                const auto& block = script.blocks[b];
+                return block.ppq + block.bpm / (60.0 * script.sampleRate) * block.numSamples;
+            };
+            while (last + 1 < script.blocks.size() && script.blocks[last + 1].isPlaying
+                   && std::abs(script.blocks[last + 1].ppq - endOf(last)) < 1.0e-9)
+                ++last;
+
+            const double startPpq = script.blocks[first].ppq;
+            const double endPpq = endOf(last);
+            const long long cutSample = script.blocks[last].startSample + script.blocks[last].numSamples;
+
+            for (long long n = (long long)std::ceil(startPpq / stepQuarters - 1.0e-9);; ++n) {
+                const bool odd = (n % c.numSteps) % 2 == 1;
+                const double onPpq = ((double)n + (odd ? c.swing : 0.0f)) * stepQuarters;
+                if (onPpq >= endPpq) break;
+
+                // Rounded up onto the host's next block, where it relocates or stops: never starts
+                const long long onSample = sampleOf(script, first, last, onPpq);
+                if (onSample >= cutSample) break;
+
+                const double offPpq = onPpq + c.gate * stepQuarters;
+                notes.push_back({ onSample, true });
+                notes.push_back({ offPpq < endPpq ? sampleOf(script, first, last, offPpq) : cutSample, false });
+            }
+            first = last + 1;
+        }
+        std::sort(notes.begin(), notes.end());
+        return notes;
+    }
+
+    //==============================================================================
+    void setParameter(StepSequencerAudioProcessor& processor, const char* id, float value)
+    {
+        auto* parameter = processor.apvts.getParameter(id);
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+
+    std::vector<NoteEvent> playScript(const Script& script, const Case& c)
+    {
+        StepSequencerAudioProcessor processor;
+        setParameter(processor, "playMode", 2.0f); // Layer: each step plays at its own grid position
+        setParameter(processor, "steps", c.legacy ? 1.0f : (float)c.numSteps);
+        setParameter(processor, "stepRate", c.legacy ? 9.0f : (float)c.rate);
+
+        SharedPattern::Steps steps((size_t)c.numSteps, SequencerCore::makeEmptyStep());
+        for (int i = 0; i < c.numSteps; ++i) {
+            auto& s = steps[(size_t)i];
+            s.active = true;
+            s.note = 60;
+            s.gate = c.gate;
+            s.offset = i % 2 == 1 ? c.swing : 0.0f;
+        }
+        processor.engine.setPattern(0, SharedPattern(std::move(steps)));
+
+        ScriptedPlayHead playHead;
+        processor.setPlayHead(&playHead);
+        processor.prepareToPlay(script.sampleRate, script.blockSize);
+        if (c.legacy) {
+            setParameter(processor, "numSteps", (float)c.numSteps);
+            setParameter(processor, "rate", (float)c.rate);
+        }
+
+        juce::AudioBuffer<float> audio (2, script.blockSize);
+        juce::MidiBuffer midi;
+        std::vector<NoteEvent> notes;
+
+        for (const auto& block : script.blocks) {
+            playHead.block = &block;
+            midi.clear();
+            processor.processBlock(audio, midi);
+
+            for (const auto metadata : midi) {
+                const auto message = metadata.getMessage();
+                if (message.isNoteOn()) notes.push_back({ block.startSample + metadata.samplePosition, true });
+                else if (message.isNoteOff()) notes.push_back({ block.startSample + metadata.samplePosition, false });
+            }
+        }
+        processor.releaseResources();
+        std::sort(notes.begin(), notes.end());
+        return notes;
+    }
+
+    //==============================================================================
+    Script makeScript(int blockSize)
+    {
+        Script script;
+        script.blockSize = blockSize;
+        script.play(2.0);
+        script.setTempo(90.0);      // Tempo jumps
+        script.play(1.5);
+        script.setTempo(174.0);
+        script.play(1.0);
+        script.relocate(0.6);       // Loop back, off the grid
+        script.play(1.0);
+        script.stop(3);
+        script.relocate(2.3);       // Start somewhere else
+        script.play(1.0);
+        script.stop(1);
+        return script;
+    }
+
+    int failures = 0;
+
+    // A state saved before "steps" / "stepRate" existed loads its "numSteps" / "rate" into them
+    void checkLegacyState()
+    {
+        juce::MemoryBlock saved;
+        {
+            StepSequencerAudioProcessor processor;
+            processor.getStateInformation(saved);
+        }
+        auto xml = juce::AudioProcessor::getXmlFromBinary(saved.getData(), (int)saved.getSize());
+        std::vector<juce::XmlElement*> added;
+        for (auto* param : xml->getChildWithTagNameIterator("PARAM")) {
+            const auto id = param->getStringAttribute("id");
+            if (id == "steps" || id == "stepRate") added.push_back(param);
+            else if (id == "numSteps") param->setAttribute("value", 24);
+            else if (id == "rate") param->setAttribute("value", 3);
+        }
+        for (auto* param : added) xml->removeChildElement(param, true);
+        juce::MemoryBlock oldState;
+        juce::AudioProcessor::copyXmlToBinary(*xml, oldState);
+
+        StepSequencerAudioProcessor processor;
+        processor.setStateInformation(oldState.getData(), (int)oldState.getSize());
+        const int steps = (int)processor.apvts.getRawParameterValue("steps")->load();
+        const int rate = (int)processor.apvts.getRawParameterValue("stepRate")->load();
+        if (steps == 24 && rate == 3) return;
+
+        failures++;
+        std::printf("FAIL legacy state: steps %d, rate %d (expected 24, 3)\n", steps, rate);
+    }
+
+    void check(const Script& script, const Case& c)
+    {
+        const auto expected = expectedNotes(script, c);
+        const auto sent = playScript(script, c);
+        if (sent == expected) return;
+
+        failures++;
+        std::printf("FAIL block %d, rate %d, %d steps, swing %.2f%s: %d notes sent, %d expected\n",
+                    script.blockSize, c.rate, c.numSteps, c.swing, c.legacy ? " (legacy)" : "", (int)sent.size(), (int)expected.size());
+        for (size_t i = 0; i < std::max(sent.size(), expected.size()); ++i) {
+            const bool same = i < sent.size() && i < expected.size() && sent[i] == expected[i];
+            if (same) continue;
+            std::printf("  first difference at %d: sent %s @ %lld, expected %s @ %lld\n", (int)i,
+                        i < sent.size() ? (sent[i].isNoteOn ? "on" : "off") : "-", i < sent.size() ? sent[i].sample : -1LL,
+                        i < expected.size() ? (expected[i].isNoteOn ? "on" : "off") : "-", i < expected.size() ? expected[i].sample : -1LL);
+            break;
+        }
+    }
+}
+
+int main()
+{
+    const juce::ScopedJuceInitialiser_GUI juce; // The processor's timer needs a message manager
+
+    // Every rate, step count and swing at a typical block size
+    const Script typical = makeScript(511);
+    for (int rate = 0; rate < SequencerCore::NUM_RATES; ++rate)
+        for (int numSteps : { 1, 5, 16, 32 })
+            for (float swing : { 0.0f, 0.25f, 0.5f })
+                check(typical, { rate, numSteps, swing });
+
+    // Odd block sizes, down to one sample
+    for (int blockSize : { 1, 7, 4096 }) {
+        const Script script = makeScript(blockSize);
+        for (int rate : { 2, 5, 9 })
+            check(script, { rate, 16, 0.25f });
+    }
+
+    // Old automation: the original parameters still drive the grid when they move last
+    // (away from their defaults, 16 steps at 1/16)
+    for (int rate : { 0, 1, 3 })
+        check(typical, { rate, 5, 0.25f, 0.5f, true });
+    checkLegacyState();
+
+    std::printf("%s\n", failures == 0 ? "All timing checks passed" : "Timing checks failed");
+    return failures == 0 ? 0 : 1;
+}
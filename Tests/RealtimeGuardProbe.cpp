@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+    RealtimeGuardProbe.cpp
+    Shared library for RealtimeGuardTest: the guard built the way the plugin is
+
+    Built with STEPSEQ_RT_GUARD=1 and the plugin's guard link options, and
+    dlopen'd by the test the way a host loads the plugin. Each call that can
+    stall the audio thread is made once inside a ScopedRealtimeSection on its
+    own thread, then again outside it, and the violations counted.
+  ==============================================================================
+*/
+
+#include "../Source/RealtimeGuard.h"
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+
+namespace
+{
+    const char* const kinds[] = { "heap allocation", "malloc()", "calloc()", "realloc()", "posix_memalign()",
+                                  "mutex lock", "open()", "write()", "read()", "usleep()", "nanosleep()" };
+    constexpr int numKinds = (int)(sizeof(kinds) / sizeof(kinds[0]));
+
+    int counts[numKinds] = {};
+    int otherCount = 0;
+
+    void countViolation(const char* what)
+    {
+        for (int i = 0; i < numKinds; ++i) {
+            if (std::strncmp(what, kinds[i], std::strlen(kinds[i])) == 0) { counts[i]++; return; }
+        }
+        otherCount++;
+    }
+
+    // volatile keeps the compiler from eliding the allocations
+    int* volatile allocated = nullptr;
+    char* volatile buffer = nullptr;
+    void* volatile zeroed = nullptr;
+    void* volatile aligned = nullptr;
+    std::mutex mutex;
+
+    // One of each blocking call; the file and memory are released by the caller
+    int makeBlockingCalls()
+    {
+        allocated = new int (1);
+
+        // A buffer grown the way a C library would
+        buffer = static_cast<char*>(std::malloc(16));
+        for (size_t size = 32; size <= 4096; size *= 2) {
+            if (char* grown = static_cast<char*>(std::realloc(buffer, size))) buffer = grown;
+        }
+        zeroed = std::calloc(4, sizeof(int));
+        void* memory = nullptr;
+        if (::posix_memalign(&memory, 64, 256) == 0) aligned = memory;
+
+        mutex.lock();
+        mutex.unlock();
+
+        const int fd = ::open("/dev/null", O_RDWR);
+        char byte = 0;
+        if (fd >= 0) {
+            if (::write(fd, &byte, 1) < 0) byte = 1;
+            if (::read(fd, &byte, 1) < 0) byte = 1;
+        }
+
+        ::usleep(0);
+        const timespec duration { 0, 0 };
+        ::nanosleep(&duration, nullptr);
+        return fd;
+    }
+
+    void closeAndFree(int fd)
+    {
+        if (fd >= 0) ::close(fd);
+        delete allocated;
+        std::free(buffer);
+        std::free(zeroed);
+        std::free(aligned);
+        allocated = nullptr;
+        buffer = nullptr;
+        zeroed = nullptr;
+        aligned = nullptr;
+    }
+}
+
+// counts: one per kind in the order above, then unrecognised violations, then violations
+// outside the section. Returns the number of slots written.
+extern "C" __attribute__((visibility("default"))) int runGuardProbe(int* result, int maxResults)
+{
+    if (maxResults < numKinds + 2) return 0;
+
+    RealtimeGuard::setViolationHandler(countViolation);
+
+    std::thread audio ([] {
+        int fd = -1;
+        {
+            const RealtimeGuard::ScopedRealtimeSection realtime;
+            fd = makeBlockingCalls();
+        }
+        closeAndFree(fd);
+    });
+    audio.join();
+
+    for (int i = 0; i < numKinds; ++i) result[i] = counts[i];
+    result[numKinds] = otherCount;
+
+    // Outside a section: nothing reported
+    int before = otherCount;
+    for (int c : counts) before += c;
+    std::thread other ([] { closeAndFree(makeBlockingCalls()); });
+    other.join();
+    int after = otherCount;
+    for (int c : counts) after += c;
+    result[numKinds + 1] = after - before;
+
+    RealtimeGuard::setViolationHandler(nullptr);
+    return numKinds + 2;
+}
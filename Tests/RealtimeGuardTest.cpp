@@ -0,0 +1,53 @@
+/*
+  ==============================================================================
+    RealtimeGuardTest.cpp
+    The STEPSEQ_RT_GUARD checks in a dlopen'd library (ctest: StepSequencerGuardTest)
+
+    Hosts load the plugin with dlopen, where their own libc / libstdc++ come
+    first in symbol lookup, so this loads the guard the same way (see
+    RealtimeGuardProbe.cpp) and checks every interposed call is reported from a
+    realtime section, and nothing outside one.
+  ==============================================================================
+*/
+
+#include <cstdio>
+#include <dlfcn.h>
+
+int main(int argc, char** argv)
+{
+    const char* path = argc > 1 ? argv[1] : "./libStepSequencerGuardProbe.so";
+    void* library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (library == nullptr) {
+        std::printf("FAIL cannot load %s: %s\n", path, dlerror());
+        return 1;
+    }
+
+    using ProbeFn = int (*) (int*, int);
+    auto probe = reinterpret_cast<ProbeFn>(dlsym(library, "runGuardProbe"));
+    if (probe == nullptr) {
+        std::printf("FAIL no runGuardProbe in %s\n", path);
+        return 1;
+    }
+
+    const char* const kinds[] = { "heap allocation", "malloc()", "calloc()", "realloc()", "posix_memalign()",
+                                  "mutex lock", "open()", "write()", "read()", "usleep()", "nanosleep()" };
+    constexpr int numKinds = (int)(sizeof(kinds) / sizeof(kinds[0]));
+    int result[numKinds + 2] = {};
+    if (probe(result, numKinds + 2) != numKinds + 2) {
+        std::printf("FAIL probe result size\n");
+        return 1;
+    }
+
+    int failures = 0;
+    for (int i = 0; i < numKinds; ++i) {
+        const bool caught = result[i] > 0;
+        std::printf("%s %s in a realtime section (%d)\n", caught ? "PASS" : "FAIL", kinds[i], result[i]);
+        if (!caught) failures++;
+    }
+    std::printf("%s nothing reported outside a section (%d)\n", result[numKinds + 1] == 0 ? "PASS" : "FAIL", result[numKinds + 1]);
+    if (result[numKinds + 1] != 0) failures++;
+    if (result[numKinds] != 0) std::printf("     (%d other violations)\n", result[numKinds]);
+
+    dlclose(library);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,429 @@
+/*
+  ==============================================================================
+    SequencerEngineTests.cpp
+    Playback tests for the JUCE-free core (ctest: StepSequencerCoreTests)
+  ==============================================================================
+*/
+
+#include "SequencerEngine.h"
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { if (!(condition)) { std::printf("  FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); failures++; } } while (false)
+
+//==============================================================================
+// Plays the engine block by block from ppq 0 and keeps what it sends
+struct Player
+{
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int blockSize = 512;
+
+    SequencerEngine& engine;
+    SequencerEngine::Settings settings;
+    double bpm = 120.0;
+    double ppq = 0.0;
+    std::vector<MidiEvent> sent;  // sampleOffset made absolute
+    long long samplesPlayed = 0;
+
+    explicit Player(SequencerEngine& e) : engine(e) { engine.prepare(sampleRate, blockSize); }
+
+    void playBlock(const std::vector<MidiEvent>& input = {}, bool playing = true)
+    {
+        SequencerEngine::Transport transport;
+        transport.isPlaying = playing;
+        transport.hasPosition = true;
+        transport.ppq = ppq;
+        transport.bpm = bpm;
+
+        engine.setSettings(settings);
+        for (const auto& e : engine.process(blockSize, transport, input.data(), (int)input.size())) {
+            MidiEvent copy = e;
+            copy.sampleOffset += (int)samplesPlayed;
+            sent.push_back(copy);
+        }
+        samplesPlayed += blockSize;
+        if (playing) ppq += bpm / 60.0 * blockSize / sampleRate;
+    }
+
+    void playQuarters(double quarters)
+    {
+        const double end = ppq + quarters;
+        while (ppq < end) playBlock();
+    }
+
+    void stop() { playBlock({}, false); }
+
+    int count(int status, int note = -1) const
+    {
+        int n = 0;
+        for (const auto& e : sent) {
+            bool isNoteOn = (e.bytes[0] & 0xf0) == 0x90 && e.bytes[2] > 0;
+            bool isNoteOff = (e.bytes[0] & 0xf0) == 0x80 || ((e.bytes[0] & 0xf0) == 0x90 && e.bytes[2] == 0);
+            bool matches = status == 0x90 ? isNoteOn : status == 0x80 ? isNoteOff : (e.bytes[0] & 0xf0) == status;
+            if (matches && (note < 0 || e.bytes[1] == note)) n++;
+        }
+        return n;
+    }
+
+    // Every note-off answers a note-on on the same channel and note, and nothing is left held
+    bool notesBalanced() const
+    {
+        int held[16][128] = {};
+        for (const auto& e : sent) {
+            int channel = e.bytes[0] & 0x0f;
+            if ((e.bytes[0] & 0xf0) == 0x90 && e.bytes[2] > 0) held[channel][e.bytes[1]]++;
+            else if ((e.bytes[0] & 0xf0) == 0x80) {
+                if (held[channel][e.bytes[1]] == 0) return false;
+                held[channel][e.bytes[1]]--;
+            }
+        }
+        for (auto& channel : held)
+            for (int n : channel)
+                if (n != 0) return false;
+        return true;
+    }
+};
+
+static SharedPattern makePattern(int length, int note, float gate, int every = 1)
+{
+    SharedPattern::Steps steps((size_t)length, SequencerCore::makeEmptyStep());
+    for (int i = 0; i < length; i += every) {
+        steps[(size_t)i].active = true;
+        steps[(size_t)i].note = note;
+        steps[(size_t)i].gate = gate;
+    }
+    return SharedPattern(std::move(steps));
+}
+
+//==============================================================================
+static void twoTracksOnTheSameNoteKeepStepping()
+{
+    // Both tracks start note 60 on channel 1 at step 1. The second note-on ends the first
+    // track's note early; that track must carry on stepping rather than wait for its own note-off.
+    SequencerEngine engine;
+    engine.addTrack();
+    engine.setGlobalNumSteps(16);
+    engine.setGlobalRate(2); // 1/16
+    engine.setPattern(0, makePattern(16, 60, 0.25f));
+    engine.setPattern(1, makePattern(16, 60, 0.25f, 16)); // Step 1 only
+
+    Player player (engine);
+    player.settings.playMode = SequencerEngine::PlayModeLayer;
+    player.playQuarters(7.9); // Two loops
+    player.stop();
+
+    CHECK(player.count(0x90, 60) == 2 * 16 + 2);
+    CHECK(player.notesBalanced());
+}
+
+static void voiceStealingKeepsTheVictimStepping()
+{
+    // One voice per channel: whichever track starts a note takes the other track's voice
+    SequencerEngine engine;
+    engine.addTrack();
+    engine.setGlobalNumSteps(16);
+    engine.setGlobalRate(2);
+    engine.setPattern(0, makePattern(16, 60, 0.25f));
+    engine.setPattern(1, makePattern(16, 64, 0.25f, 4));
+
+    Player player (engine);
+    player.settings.playMode = SequencerEngine::PlayModeLayer;
+    player.settings.voiceLimit = 1;
+    player.playQuarters(7.9);
+    player.stop();
+
+    CHECK(player.count(0x90, 60) == 2 * 16);
+    CHECK(player.count(0x90, 64) == 2 * 4);
+    CHECK(player.notesBalanced());
+}
+
+static MidiEvent makeNote(bool on, int note, int sampleOffset)
+{
+    MidiEvent e;
+    e.sampleOffset = sampleOffset;
+    e.bytes[0] = on ? 0x90 : 0x80;
+    e.bytes[1] = (std::uint8_t)note;
+    e.bytes[2] = on ? 100 : 0;
+    e.size = 3;
+    return e;
+}
+
+static void inputGateReopensThePattern()
+{
+    // Gate mode: the pattern sounds while a key is down. Letting go cuts the notes; the next
+    // key brings the pattern straight back, without waiting for a transport restart.
+    SequencerEngine engine;
+    engine.setGlobalNumSteps(16);
+    engine.setGlobalRate(2);
+    engine.setPattern(0, makePattern(16, 60, 0.25f));
+
+    Player player (engine);
+    player.settings.inputMode = SequencerEngine::InputTranspose;
+    player.settings.inputHold = SequencerEngine::InputGate;
+
+    player.playBlock({ makeNote(true, 60, 0) });
+    player.playQuarters(2.0);
+    const int whileHeld = player.count(0x90, 60);
+    CHECK(whileHeld >= 8);
+
+    player.playBlock({ makeNote(false, 60, 100) });
+    player.playQuarters(2.0);
+    CHECK(player.count(0x90, 60) == whileHeld); // Closed: nothing new
+    CHECK(player.notesBalanced());
+
+    player.playBlock({ makeNote(true, 60, 0) });
+    player.playQuarters(2.0);
+    CHECK(player.count(0x90, 60) >= whileHeld + 8);
+
+    player.stop();
+    CHECK(player.notesBalanced());
+}
+
+static void inputOffPassesNotesThrough()
+{
+    // MIDI clock sync hands the engine every input note, whatever "MIDI In" is set to. With it
+    // off, the notes go straight out and the pattern plays as if there were no input at all -
+    // no gate releasing it on a key-up, no retune of what is sounding.
+    auto play = [](SequencerEngine& engine, bool withInput) {
+        engine.setGlobalNumSteps(16);
+        engine.setGlobalRate(2);
+        engine.setPattern(0, makePattern(16, 60, 0.9f));
+
+        Player player (engine);
+        player.settings.inputMode = SequencerEngine::InputOff;
+        player.settings.inputHold = SequencerEngine::InputGate;
+        player.settings.inputApply = SequencerEngine::InputApplyImmediate;
+        player.playQuarters(0.5);
+        if (withInput) player.playBlock({ makeNote(true, 72, 10), makeNote(false, 72, 200) });
+        else player.playBlock();
+        player.playQuarters(1.0);
+        player.stop();
+        return player;
+    };
+
+    SequencerEngine plainEngine, inputEngine;
+    const Player plain = play(plainEngine, false);
+    const Player withInput = play(inputEngine, true);
+    CHECK(withInput.count(0x90, 72) == 1);
+    CHECK(withInput.count(0x80, 72) == 1);
+
+    std::vector<MidiEvent> pattern;
+    for (const auto& e : withInput.sent)
+        if (e.bytes[1] != 72) pattern.push_back(e);
+    CHECK(pattern.size() == plain.sent.size());
+    for (size_t i = 0; i < pattern.size() && i < plain.sent.size(); ++i)
+        CHECK(pattern[i].sampleOffset == plain.sent[i].sampleOffset && std::memcmp(pattern[i].bytes, plain.sent[i].bytes, 3) == 0);
+}
+
+static int findEvent(const Player& player, int status, int note, int from = 0)
+{
+    for (const auto& e : player.sent) {
+        bool matches = status == 0x90 ? (e.bytes[0] & 0xf0) == 0x90 && e.bytes[2] > 0 : (e.bytes[0] & 0xf0) == status;
+        if (matches && e.bytes[1] == note && e.sampleOffset >= from) return e.sampleOffset;
+    }
+    return -1;
+}
+
+static void noteOffsRunWhileTheEditorHoldsTheLock()
+{
+    // Step 1's note-off (0.15625 quarters, sample 3750) comes after step 2 is due to be decided
+    // (0.125 quarters). With the editor holding the lock over both, the decision waits but the
+    // note-off is still sent on time, and step 2 still starts on time once the lock is free.
+    SequencerEngine engine;
+    engine.setGlobalNumSteps(16);
+    engine.setGlobalRate(2);
+    engine.setPattern(0, makePattern(16, 60, 0.625f));
+
+    Player player (engine);
+    for (int block = 0; block < 16; ++block) {
+        if (block >= 5 && block <= 7) {
+            const std::lock_guard<SpinLock> lock (engine.structureLock);
+            player.playBlock();
+        }
+        else player.playBlock();
+    }
+    player.stop();
+
+    CHECK(findEvent(player, 0x80, 60) == 3750);
+    CHECK(findEvent(player, 0x90, 60, 1) == 6000);
+    CHECK(player.notesBalanced());
+}
+
+static void relocationWhileTheEditorHoldsTheLock()
+{
+    // A loop back lands in a block without the lock: the ringing note is cut there and then,
+    // and playback carries on from the new position a block later
+    SequencerEngine engine;
+    engine.setGlobalNumSteps(16);
+    engine.setGlobalRate(2);
+    engine.setPattern(0, makePattern(16, 60, 2.0f));
+
+    Player player (engine);
+    player.playQuarters(1.1);
+    const int onsBefore = player.count(0x90, 60);
+    player.ppq = 0.0;
+    const long long loopSample = player.samplesPlayed;
+    {
+        const std::lock_guard<SpinLock> lock (engine.structureLock);
+        player.playBlock();
+    }
+    CHECK(player.count(0x80, 60) == onsBefore); // Everything released in the loop block
+    CHECK(findEvent(player, 0x80, 60, (int)loopSample) == (int)loopSample);
+
+    player.playQuarters(1.0);
+    CHECK(player.count(0x90, 60) > onsBefore);
+    player.stop();
+    CHECK(player.notesBalanced());
+}
+
+static void fullySwungStepsStillPlay()
+{
+    // Odd steps pushed late by the full MAX_STEP_OFFSET start exactly where the next step is
+    // decided - the note-on must win that tie, at every rate
+    for (int rate = 0; rate < SequencerCore::NUM_RATES; ++rate) {
+        SequencerEngine engine;
+        engine.setGlobalNumSteps(16);
+        engine.setGlobalRate(rate);
+        SharedPattern::Steps steps((size_t)16, SequencerCore::makeEmptyStep());
+        for (int i = 0; i < 16; ++i) {
+            steps[(size_t)i].active = true;
+            steps[(size_t)i].gate = 0.25f;
+            steps[(size_t)i].offset = i % 2 == 1 ? SequencerCore::MAX_STEP_OFFSET : 0.0f;
+        }
+        engine.setPattern(0, SharedPattern(std::move(steps)));
+
+        Player player (engine);
+        player.settings.playMode = SequencerEngine::PlayModeLayer;
+        const double stepQuarters = SequencerCore::getRateQuarters(rate);
+        player.playQuarters(16 * stepQuarters);
+        const long long endSample = player.samplesPlayed;
+        player.stop();
+
+        // Every onset up to the last sample played (on its first sample at or after the exact time)
+        const double quartersPerSample = player.bpm / (60.0 * Player::sampleRate);
+        int expected = 0;
+        for (int n = 0; std::ceil((n + (n % 2 == 1 ? 0.5 : 0.0)) * stepQuarters / quartersPerSample - 1.0e-6) < endSample; ++n) expected++;
+        CHECK(player.count(0x90, 60) == expected);
+        CHECK(player.notesBalanced());
+    }
+}
+
+static void trackLengthChangeRedecidesEarlySteps()
+{
+    // Steps play notes 60, 61, 62... a quarter step early, so each is decided before its grid
+    // position. Cutting the track to 4 steps between step 7's decision (1.375 quarters) and its
+    // note-on (1.4375) decides it again with the new length, like every step after it.
+    SequencerEngine engine;
+    engine.setGlobalNumSteps(16);
+    engine.setGlobalRate(2); // 1/16: a quarter of a quarter, 6000 samples
+    SharedPattern::Steps steps((size_t)16, SequencerCore::makeEmptyStep());
+    for (int i = 0; i < 16; ++i) {
+        steps[(size_t)i].active = true;
+        steps[(size_t)i].note = 60 + i;
+        steps[(size_t)i].gate = 0.25f;
+        steps[(size_t)i].offset = -0.25f;
+    }
+    engine.setPattern(0, SharedPattern(std::move(steps)));
+
+    Player player (engine);
+    player.settings.playMode = SequencerEngine::PlayModeLayer;
+    player.playQuarters(1.4);
+    const long long changeSample = player.samplesPlayed;
+    engine.setTrackLength(0, 4);
+    player.playQuarters(1.0);
+    player.stop();
+
+    const double samplesPerStep = 60.0 / player.bpm * Player::sampleRate * SequencerCore::getRateQuarters(2);
+    int checked = 0;
+    for (const auto& e : player.sent) {
+        if ((e.bytes[0] & 0xf0) != 0x90 || e.bytes[2] == 0 || e.sampleOffset < changeSample) continue;
+        const int gridStep = (int)std::lround(e.sampleOffset / samplesPerStep + 0.25);
+        CHECK(e.bytes[1] == 60 + gridStep % 4);
+        checked++;
+    }
+    CHECK(checked == 4);
+    CHECK(player.notesBalanced());
+}
+
+static void rateChangeKeepsRatchetHitsInPlace()
+{
+    // One 1/4 step with four ratchets: hits at 0, 6000, 12000 and 18000 samples. Switching the
+    // track to 1/32 between the second and third hit must leave the rest where they were - spread
+    // from the step's start at the new length, the last hit would land in the past.
+    SequencerEngine engine;
+    engine.setGlobalNumSteps(16);
+    engine.setGlobalRate(0); // 1/4
+    SharedPattern::Steps steps((size_t)16, SequencerCore::makeEmptyStep());
+    steps[0].active = true;
+    steps[0].gate = 0.5f;
+    steps[0].ratchets = 4;
+    engine.setPattern(0, SharedPattern(std::move(steps)));
+
+    Player player (engine);
+    player.playQuarters(0.3);
+    engine.setTrackRate(0, 3); // 1/32: the next loop starts at 2 quarters
+    player.playQuarters(1.0);
+    player.stop();
+
+    std::vector<int> hits;
+    for (const auto& e : player.sent)
+        if ((e.bytes[0] & 0xf0) == 0x90 && e.bytes[2] > 0) hits.push_back(e.sampleOffset);
+    CHECK((hits == std::vector<int> { 0, 6000, 12000, 18000 }));
+    CHECK(player.notesBalanced());
+}
+
+static void replaceRecordingClearsLongTracks()
+{
+    // Replace recording clears each step as it passes. Far more steps pass than the record
+    // queue holds while the message thread applies nothing - none of them may be lost.
+    SequencerEngine engine;
+    engine.setGlobalNumSteps(768);
+    engine.setGlobalRate(3); // 1/32
+    engine.setPattern(0, makePattern(768, 60, 0.5f));
+
+    Player player (engine);
+    player.settings.recordMode = SequencerEngine::RecordReplace;
+    player.playQuarters(87.5); // 700 steps
+    engine.applyRecordedEdits();
+    player.playBlock();           // The steps cleared since go out once the queue has been read
+    engine.applyRecordedEdits();
+
+    const auto& steps = engine.getPattern(0);
+    int cleared = 0;
+    for (int i = 0; i < 700; ++i)
+        if (!steps[(size_t)i].active) cleared++;
+    CHECK(cleared == 700);
+    CHECK(steps[767].active);
+    CHECK(engine.droppedRecordEdits == 0);
+}
+
+//==============================================================================
+int main()
+{
+    struct Test { const char* name; void (*run)(); };
+    const Test tests[] = {
+        { "twoTracksOnTheSameNoteKeepStepping", twoTracksOnTheSameNoteKeepStepping },
+        { "voiceStealingKeepsTheVictimStepping", voiceStealingKeepsTheVictimStepping },
+        { "inputGateReopensThePattern", inputGateReopensThePattern },
+        { "inputOffPassesNotesThrough", inputOffPassesNotesThrough },
+        { "noteOffsRunWhileTheEditorHoldsTheLock", noteOffsRunWhileTheEditorHoldsTheLock },
+        { "relocationWhileTheEditorHoldsTheLock", relocationWhileTheEditorHoldsTheLock },
+        { "fullySwungStepsStillPlay", fullySwungStepsStillPlay },
+        { "trackLengthChangeRedecidesEarlySteps", trackLengthChangeRedecidesEarlySteps },
+        { "rateChangeKeepsRatchetHitsInPlace", rateChangeKeepsRatchetHitsInPlace },
+        { "replaceRecordingClearsLongTracks", replaceRecordingClearsLongTracks },
+    };
+
+    for (const auto& test : tests) {
+        const int before = failures;
+        test.run();
+        std::printf("%s %s\n", failures == before ? "PASS" : "FAIL", test.name);
+    }
+    return failures == 0 ? 0 : 1;
+}